@@ -0,0 +1,372 @@
+#include <processing/math.hpp>
+#include <processing/pixel_kernels.hpp>
+#include <processing/shape_builder.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Prints one JSON object per benchmark and line: name, iterations, ns_per_op and allocs_per_op.
+// Pass a substring as the first argument to run only the matching benchmarks. The SIMD pixel kernels
+// are checked against the scalar ones first, a mismatch is reported and fails the run.
+
+namespace
+{
+    std::atomic<std::uint64_t> s_allocationCount = 0;
+} // namespace
+
+void* operator new(const std::size_t size)
+{
+    s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace processing
+{
+    inline static constexpr std::chrono::nanoseconds MIN_BENCHMARK_TIME = std::chrono::milliseconds(200);
+
+    template <typename T>
+    inline static void doNotOptimize(const T& value)
+    {
+#if defined(_MSC_VER)
+        const volatile char sink = *reinterpret_cast<const volatile char*>(&value);
+        static_cast<void>(sink);
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    struct BenchmarkResult
+    {
+        u64 iterations;
+        f64 nanosecondsPerOperation;
+        f64 allocationsPerOperation;
+    };
+
+    template <typename Operation>
+    inline static BenchmarkResult measure(Operation& operation, const u64 iterations)
+    {
+        const u64 allocationsBefore = s_allocationCount.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+
+        for (u64 i = 0; i < iterations; ++i)
+        {
+            operation();
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const u64 allocations = s_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+        return BenchmarkResult{
+            .iterations = iterations,
+            .nanosecondsPerOperation = static_cast<f64>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / static_cast<f64>(iterations),
+            .allocationsPerOperation = static_cast<f64>(allocations) / static_cast<f64>(iterations),
+        };
+    }
+
+    // Only the operation is timed, the setup restores its input before every iteration.
+    template <typename Setup, typename Operation>
+    inline static BenchmarkResult measure(Setup& setup, Operation& operation, const u64 iterations)
+    {
+        std::chrono::steady_clock::duration elapsed = {};
+        u64 allocations = 0;
+
+        for (u64 i = 0; i < iterations; ++i)
+        {
+            setup();
+
+            const u64 allocationsBefore = s_allocationCount.load(std::memory_order_relaxed);
+            const auto start = std::chrono::steady_clock::now();
+            operation();
+            elapsed += std::chrono::steady_clock::now() - start;
+            allocations += s_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        }
+
+        return BenchmarkResult{
+            .iterations = iterations,
+            .nanosecondsPerOperation = static_cast<f64>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / static_cast<f64>(iterations),
+            .allocationsPerOperation = static_cast<f64>(allocations) / static_cast<f64>(iterations),
+        };
+    }
+
+    template <typename Measure>
+    inline static void report(const std::string_view filter, const std::string_view name, Measure&& measureIterations)
+    {
+        if (not filter.empty() and name.find(filter) == std::string_view::npos)
+        {
+            return;
+        }
+
+        // Doubles the iteration count until a run takes long enough to be measured reliably.
+        u64 iterations = 1;
+        BenchmarkResult result = measureIterations(iterations);
+        while (result.nanosecondsPerOperation * static_cast<f64>(iterations) < static_cast<f64>(MIN_BENCHMARK_TIME.count()))
+        {
+            iterations *= 2;
+            result = measureIterations(iterations);
+        }
+
+        std::printf("{\"name\":\"%.*s\",\"iterations\":%llu,\"ns_per_op\":%.3f,\"allocs_per_op\":%.3f}\n", static_cast<int>(name.size()), name.data(), static_cast<unsigned long long>(result.iterations), result.nanosecondsPerOperation, result.allocationsPerOperation);
+        std::fflush(stdout);
+    }
+
+    template <typename Operation>
+    inline static void benchmark(const std::string_view filter, const std::string_view name, Operation&& operation)
+    {
+        report(filter, name, [&](const u64 iterations) { return measure(operation, iterations); });
+    }
+
+    template <typename Setup, typename Operation>
+    inline static void benchmark(const std::string_view filter, const std::string_view name, Setup&& setup, Operation&& operation)
+    {
+        report(filter, name, [&](const u64 iterations) { return measure(setup, operation, iterations); });
+    }
+
+    inline static constexpr std::string_view strokeJoinName(const StrokeJoin strokeJoin)
+    {
+        switch (strokeJoin)
+        {
+                // clang-format off
+            case StrokeJoin::miter: return "miter";
+            case StrokeJoin::bevel: return "bevel";
+            case StrokeJoin::round: return "round";
+                // clang-format on
+        }
+
+        return "unknown";
+    }
+
+    inline static constexpr std::string_view strokeCapName(const StrokeCapStyle strokeCap)
+    {
+        switch (strokeCap)
+        {
+                // clang-format off
+            case StrokeCapStyle::butt: return "butt";
+            case StrokeCapStyle::square: return "square";
+            case StrokeCapStyle::round: return "round";
+                // clang-format on
+        }
+
+        return "unknown";
+    }
+
+    inline static constexpr std::string_view blendModeName(const BlendMode blendMode)
+    {
+        switch (blendMode)
+        {
+                // clang-format off
+            case BlendMode::opaque: return "opaque";
+            case BlendMode::alpha: return "alpha";
+            case BlendMode::premultiplied: return "premultiplied";
+            case BlendMode::additive: return "additive";
+            case BlendMode::multiply: return "multiply";
+            case BlendMode::screen: return "screen";
+            case BlendMode::subtract: return "subtract";
+                // clang-format on
+        }
+
+        return "unknown";
+    }
+
+    inline static constexpr std::string_view pixelKernelLevelName(const PixelKernelLevel level)
+    {
+        switch (level)
+        {
+                // clang-format off
+            case PixelKernelLevel::scalar: return "scalar";
+            case PixelKernelLevel::sse2: return "sse2";
+            case PixelKernelLevel::avx2: return "avx2";
+                // clang-format on
+        }
+
+        return "unknown";
+    }
+
+    inline static std::string name(const std::string_view base, const std::string_view variant)
+    {
+        std::string result{base};
+        result += "/";
+        result += variant;
+        return result;
+    }
+
+    struct PixelOperation
+    {
+        std::string name;
+        std::function<void(const PixelKernels& kernels, u32* pixels, usize count)> run;
+    };
+
+    // The SIMD levels have to reproduce the scalar results bit for bit. The odd count covers the
+    // scalar tails of the vector loops as well.
+    inline static bool verifyPixelKernels(const std::vector<PixelOperation>& operations, const std::vector<u32>& pristine)
+    {
+        const usize count = pristine.size() - 5;
+        bool isValid = true;
+
+        for (const PixelKernelLevel level : {PixelKernelLevel::sse2, PixelKernelLevel::avx2})
+        {
+            const PixelKernels* kernels = findPixelKernels(level);
+            if (kernels == nullptr)
+            {
+                continue;
+            }
+
+            for (const PixelOperation& operation : operations)
+            {
+                std::vector<u32> expected = pristine;
+                std::vector<u32> actual = pristine;
+                operation.run(getScalarPixelKernels(), expected.data(), count);
+                operation.run(*kernels, actual.data(), count);
+
+                if (expected != actual)
+                {
+                    const std::string operationName = name(operation.name, pixelKernelLevelName(level));
+                    std::printf("{\"name\":\"%s\",\"error\":\"differs from the scalar kernel\"}\n", operationName.c_str());
+                    std::fflush(stdout);
+                    isValid = false;
+                }
+            }
+        }
+
+        return isValid;
+    }
+
+    bool runBenchmarks(const std::string_view filter)
+    {
+        const rect2f boundary = {100.0f, 100.0f, 300.0f, 200.0f};
+        const EllipseSpecification ellipse = {
+            .center = boundary.center(),
+            .radius = Radius::elliptical(150.0f, 100.0f),
+            .segments = 32,
+        };
+
+        const RoundedRectSpecification roundedRect = {
+            .boundary = boundary,
+            .topLeft = Radius::circular(16.0f),
+            .topRight = Radius::circular(16.0f),
+            .bottomRight = Radius::circular(16.0f),
+            .bottomLeft = Radius::circular(16.0f),
+        };
+
+        const EllipsePath ellipsePath = path_ellipse(ellipse);
+        const RectPath rectPath = path_rect(boundary);
+        const RoundedRectPath roundedRectPath = path_rounded_rect(roundedRect);
+
+        benchmark(filter, "path_ellipse", [&] { doNotOptimize(path_ellipse(ellipse)); });
+        benchmark(filter, "contour_ellipse_fill", [&] { doNotOptimize(contour_ellipse_fill(ellipsePath)); });
+
+        for (const StrokeJoin strokeJoin : {StrokeJoin::miter, StrokeJoin::bevel, StrokeJoin::round})
+        {
+            const StrokeProperties properties = {.strokeJoin = strokeJoin, .strokeWeight = 4.0f, .miterLimit = 4.0f};
+
+            benchmark(filter, name("contour_ellipse_stroke", strokeJoinName(strokeJoin)), [&] { doNotOptimize(contour_ellipse_stroke(ellipsePath, properties)); });
+            benchmark(filter, name("contour_rect_stroke", strokeJoinName(strokeJoin)), [&] { doNotOptimize(contour_rect_stroke(rectPath, properties)); });
+            benchmark(filter, name("contour_rounded_rect_stroke", strokeJoinName(strokeJoin)), [&] { doNotOptimize(contour_rounded_rect_stroke(roundedRectPath, properties)); });
+        }
+
+        benchmark(filter, "path_rounded_rect", [&] { doNotOptimize(path_rounded_rect(roundedRect)); });
+        benchmark(filter, "contour_rounded_rect_fill", [&] { doNotOptimize(contour_rounded_rect_fill(roundedRectPath)); });
+
+        for (const StrokeCap strokeCap : {StrokeCap::butt, StrokeCap::square, StrokeCap::round})
+        {
+            benchmark(filter, name("contour_line", strokeCapName(strokeCap.start)), [&] { doNotOptimize(contour_line(10.0f, 20.0f, 400.0f, 300.0f, 4.0f, strokeCap)); });
+        }
+
+        const matrix4x4 transform = matrix4x4::translation(40.0f, 30.0f).combined(matrix4x4::rotation(0.5f)).combined(matrix4x4::scaling(2.0f, 2.0f));
+        const Contour contour = contour_ellipse_fill(ellipsePath);
+        float2 point = {12.0f, 34.0f};
+
+        benchmark(filter, "matrix4x4::combined", [&] { doNotOptimize(transform.combined(transform)); });
+        benchmark(filter, "matrix4x4::transformPoint", [&] { point = transform.transformPoint(point); doNotOptimize(point); });
+        benchmark(filter, "vertices_from_contour", [&] { doNotOptimize(vertices_from_contour(contour, transform, Color(255), 0.0f)); });
+        benchmark(filter, "vertices_from_contour/local", [&] { doNotOptimize(vertices_from_contour(contour, Color(255), 0.0f)); });
+
+        Xoshiro256PP random;
+        benchmark(filter, "Xoshiro256PP::next", [&] { doNotOptimize(random.next()); });
+        benchmark(filter, "Xoshiro256PP::nextFloat", [&] { doNotOptimize(random.nextFloat()); });
+
+        // One operation processes a 512x512 image of random pixels, so every alpha value and branch is
+        // exercised. Each iteration starts from an untimed copy of the same image. The scalar level is
+        // the baseline for the SIMD ones.
+        std::vector<u32> pristine(512 * 512);
+        std::vector<u32> source(512 * 512);
+        for (usize i = 0; i < pristine.size(); ++i)
+        {
+            pristine[i] = static_cast<u32>(random.next());
+            source[i] = static_cast<u32>(random.next());
+        }
+
+        std::vector<PixelOperation> operations;
+        operations.push_back(PixelOperation{"pixels/fill", [](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.fill(pixels, count, 0xFF336699); }});
+
+        for (const BlendMode blendMode : {BlendMode::opaque, BlendMode::alpha, BlendMode::premultiplied, BlendMode::additive, BlendMode::multiply, BlendMode::screen, BlendMode::subtract})
+        {
+            operations.push_back(PixelOperation{name("pixels/blend", blendModeName(blendMode)), [&source, blendMode](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.blend(pixels, source.data(), count, blendMode); }});
+        }
+
+        operations.push_back(PixelOperation{"pixels/tint", [](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.tint(pixels, count, 0xFFC08040); }});
+        operations.push_back(PixelOperation{"pixels/premultiply", [](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.premultiply(pixels, count); }});
+        operations.push_back(PixelOperation{"pixels/unpremultiply", [](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.unpremultiply(pixels, count); }});
+        operations.push_back(PixelOperation{"pixels/grayscale", [](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.grayscale(pixels, count); }});
+        operations.push_back(PixelOperation{"pixels/invert", [](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.invert(pixels, count); }});
+        operations.push_back(PixelOperation{"pixels/threshold", [](const PixelKernels& kernels, u32* pixels, const usize count) { kernels.threshold(pixels, count, 128); }});
+
+        if (not verifyPixelKernels(operations, pristine))
+        {
+            return false;
+        }
+
+        std::vector<u32> pixels(pristine.size());
+
+        for (const PixelKernelLevel level : {PixelKernelLevel::scalar, PixelKernelLevel::sse2, PixelKernelLevel::avx2})
+        {
+            const PixelKernels* kernels = findPixelKernels(level);
+            if (kernels == nullptr)
+            {
+                continue;
+            }
+
+            for (const PixelOperation& operation : operations)
+            {
+                benchmark(
+                    filter, name(operation.name, pixelKernelLevelName(level)), [&] { std::ranges::copy(pristine, pixels.begin()); },
+                    [&]
+                    {
+                        operation.run(*kernels, pixels.data(), pixels.size());
+                        doNotOptimize(pixels[0]);
+                    }
+                );
+            }
+        }
+
+        return true;
+    }
+} // namespace processing
+
+int main(const int argc, char** argv)
+{
+    return processing::runBenchmarks(argc > 1 ? std::string_view{argv[1]} : std::string_view{}) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
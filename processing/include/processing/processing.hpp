@@ -11,6 +11,8 @@
 #include <filesystem>
 #include <string_view>
 #include <optional>
+#include <span>
+#include <variant>
 
 namespace processing
 {
@@ -336,7 +338,7 @@ namespace processing
     {
         float3 position;
         float2 texcoord;
-        float4 color;
+        Color color;
     };
 
     enum class VertexMode
@@ -423,21 +425,96 @@ namespace processing
 
 namespace processing
 {
+    // Unchecked 2D access to packed pixels, rows are stride pixels apart.
+    template <typename T>
+    struct PixelView
+    {
+        T* data;
+        u32 width;
+        u32 height;
+        u32 stride;
+
+        T& operator()(const u32 x, const u32 y) const { return data[static_cast<usize>(y) * stride + x]; }
+        std::span<T> row(const u32 y) const { return std::span<T>(data + static_cast<usize>(y) * stride, width); }
+    };
+
     class PlatformImage;
     class Pixels
     {
     public:
-        explicit Pixels(u32 width, u32 height, PlatformImage* parent, const std::vector<u8>& data);
+        // set() marks the tile it writes to, commit() uploads only the dirty tiles.
+        inline static constexpr u32 DIRTY_TILE_SIZE = 64;
+
+        explicit Pixels(u32 width, u32 height, PlatformImage* parent, std::vector<u32> data);
+
+        // Pixels are stored as RGBA8, the red channel in the lowest byte.
+        static u32 pack(Color color);
+        static Color unpack(u32 pixel);
+
         void set(u32 x, u32 y, Color color);
         Color get(u32 x, u32 y) const;
 
+        u32 getWidth() const;
+        u32 getHeight() const;
+
+        // The mutable views mark every tile they cover as dirty when they are taken. Indexing them is unchecked.
+        std::span<u32> row(u32 y);
+        std::span<const u32> row(u32 y) const;
+        PixelView<u32> view();
+        PixelView<u32> view(const rect2u& region);
+        PixelView<const u32> view() const;
+        PixelView<const u32> view(const rect2u& region) const;
+
+        void fill(Color color);
+        void fill(const rect2u& region, Color color);
+        // Copies within this image, the regions may overlap.
+        void copyRect(const rect2u& source, u32 x, u32 y);
+        void blit(const Pixels& source, const rect2u& sourceRegion, u32 x, u32 y);
+        void markDirty(const rect2u& region);
+
+        // Run on SSE2 or AVX2 kernels when the CPU supports them. blend() follows the GL blend functions.
+        void blend(const Pixels& source, const rect2u& sourceRegion, u32 x, u32 y, BlendMode mode);
+        void tint(Color color);
+        void premultiply();
+        void unpremultiply();
+        void grayscale();
+        void invert();
+        void threshold(u8 level);
+
         void commit();
 
     private:
+        void markDirty(u32 x, u32 y);
+        rect2u clip(const rect2u& region) const;
+
         u32 m_width;
         u32 m_height;
         PlatformImage* m_parent;
-        std::vector<u8> m_data;
+        std::vector<u32> m_data;
+
+        u32 m_tileColumns;
+        std::vector<bool> m_dirtyTiles;
+    };
+
+    class PendingPixels;
+
+    // Pixels read into a pixel pack buffer by loadPixelsAsync(). They usually become ready a frame or
+    // two later, polling isReady() or tryGet() never waits for the GPU. Requests may be polled from any
+    // thread, with pipelinedRendering the main thread resolves them between frames and draw() sees the result.
+    // Default and rejected requests are ready at once and hold no pixels.
+    class PixelsRequest
+    {
+    public:
+        PixelsRequest();
+        explicit PixelsRequest(std::shared_ptr<PendingPixels> impl);
+
+        bool isReady() const;
+        std::optional<Pixels> tryGet() const;
+        // Blocks until the GPU has written the pixels.
+        Pixels get() const;
+
+    private:
+        std::shared_ptr<PendingPixels> m_impl;
     };
 
     struct PlatformImage
@@ -452,8 +529,12 @@ namespace processing
 
         virtual uint2 getSize() const = 0;
         virtual Pixels loadPixels() = 0;
+        virtual PixelsRequest loadPixelsAsync() = 0;
+        virtual void updatePixels(const rect2u& region, u32 rowLength, const u8* data) = 0;
 
         virtual ResourceId getResourceId() const = 0;
+        virtual rect2f getTextureRegion() const = 0;
+        virtual bool isOpaque() const = 0;
     };
 
     class Image
@@ -470,8 +551,11 @@ namespace processing
 
         uint2 getSize() const;
         Pixels loadPixels();
+        PixelsRequest loadPixelsAsync();
 
         ResourceId getResourceId() const;
+        rect2f getTextureRegion() const;
+        bool isOpaque() const;
         AssetId getAssetId() const;
 
     private:
@@ -502,6 +586,7 @@ namespace processing
         Image& getImage();
         uint2 getSize() const;
         AssetId getAssetId() const;
+        PixelsRequest loadPixelsAsync();
 
     private:
         std::shared_ptr<PlatformRenderbuffer> m_impl;
@@ -512,10 +597,47 @@ namespace processing
 
 namespace processing
 {
+    struct PlatformRecording
+    {
+        virtual ~PlatformRecording() = default;
+        virtual void draw() const = 0;
+        virtual usize getDrawCount() const = 0;
+    };
+
+    // Draw calls captured between beginRecord() and endRecord(). The geometry stays on the GPU
+    // and is replayed under the current matrix by drawRecording().
+    class Recording
+    {
+    public:
+        Recording();
+        explicit Recording(std::shared_ptr<PlatformRecording> impl);
+
+        usize getDrawCount() const;
+
+    private:
+        friend void drawRecording(const Recording& recording);
+
+        std::shared_ptr<PlatformRecording> m_impl;
+    };
+
+    void beginRecord();
+    Recording endRecord();
+    void drawRecording(const Recording& recording);
+} // namespace processing
+
+namespace processing
+{
+    using UniformValue = std::variant<i32, f32, float2, float3, float4, matrix4x4>;
+
     struct PlatformShader
     {
         virtual ~PlatformShader() = default;
         virtual ResourceId getResourceId() const = 0;
+
+        virtual i32 getUniformLocation(std::string_view name) const = 0;
+        virtual void setUniform(i32 location, const UniformValue& value) = 0;
+        virtual bool hasPendingUniforms() const = 0;
+        virtual void commitUniforms() = 0;
     };
 
     class Shader
@@ -523,6 +645,18 @@ namespace processing
     public:
         explicit Shader(AssetId assetId, std::shared_ptr<PlatformShader> impl);
 
+        void setUniform(std::string_view name, i32 value);
+        void setUniform(std::string_view name, f32 value);
+        void setUniform(std::string_view name, const float2& value);
+        void setUniform(std::string_view name, const float3& value);
+        void setUniform(std::string_view name, const float4& value);
+        void setUniform(std::string_view name, const matrix4x4& value);
+        void setUniformAt(i32 location, const UniformValue& value);
+
+        i32 getUniformLocation(std::string_view name) const;
+        bool hasPendingUniforms() const;
+        void commitUniforms();
+
         ResourceId getResourceId() const;
         AssetId getAssetId() const;
 
@@ -572,6 +706,38 @@ namespace processing
     void loop();
     void noLoop();
     void redraw();
+
+    // True when the sketch was started with --headless and renders into the root framebuffer without a window.
+    bool isHeadless();
+} // namespace processing
+
+namespace processing
+{
+    enum class Hint
+    {
+        // Packs small clamped images into shared atlas pages so they can be batched together.
+        textureAtlas,
+        // Submits local-space geometry and applies the current matrix in the vertex shader.
+        gpuTransforms,
+        // Streams default-shader geometry as 20 byte vertices with half texcoords and 16 bit depth.
+        compactVertices,
+        // Defers draws until the next flush and submits opaque ones sorted by shader, texture and blend mode.
+        sortOpaqueDraws,
+        // Defers draws like sortOpaqueDraws but submits opaque ones nearest first so early depth testing culls hidden fragments.
+        frontToBackOpaque,
+        // Tessellates strokes on a pool of worker threads, draws are still submitted in call order.
+        parallelTessellation,
+        // Read after setup(). Runs draw() on a sketch thread that records frame N+1 while the main thread submits frame N.
+        // Images, shaders and renderbuffers must be created in setup(), peekStyle() and peekMatrix() are unavailable in draw().
+        // Loading and committing pixels, changing filter or extend modes and changing hints is rejected in draw() as well.
+        pipelinedRendering,
+    };
+
+    void hint(Hint option, bool enabled = true);
+    bool isHintEnabled(Hint option);
+
+    // Bounds how many recorded frames may wait for presentation when pipelinedRendering is enabled, defaults to 2.
+    void setMaxFramesInFlight(u32 frameCount);
 } // namespace processing
 
 namespace processing
@@ -587,6 +753,127 @@ namespace processing
     int2 getMousePosition();
 } // namespace processing
 
+namespace processing
+{
+    struct StateChangeStats
+    {
+        u64 issued;
+        u64 skipped;
+    };
+
+    struct StreamBufferStats
+    {
+        usize capacity;
+        usize highWaterMark;
+        u64 growCount;
+    };
+
+    // Fragments of the front-to-back opaque pass. Covered fragments are estimated from primitive areas
+    // clipped to the framebuffer by their screen bounds, so partly visible draws are assumed to be spread
+    // evenly over those bounds and overlapping primitives within a draw count twice. Passed fragments
+    // come from occlusion queries and trail the frame by the GPU latency.
+    struct OcclusionStats
+    {
+        u64 coveredFragments;
+        u64 passedFragments;
+        u64 rejectedFragments;
+    };
+
+    // Everything handed to the driver, uploaded bytes include vertex, index, instance and matrix data.
+    struct SubmissionStats
+    {
+        u64 drawCalls;
+        u64 uploadedVertices;
+        u64 uploadedIndices;
+        u64 uploadedInstances;
+        u64 uploadedBytes;
+    };
+
+    struct PrimitiveStats
+    {
+        u64 rects;
+        u64 ellipses;
+        u64 triangles;
+        u64 points;
+        u64 lines;
+        u64 images;
+    };
+
+    // Tessellation on worker threads adds up the time of every worker.
+    struct CpuTimeStats
+    {
+        u64 tessellationNanoseconds;
+        u64 vertexConversionNanoseconds;
+        u64 submissionNanoseconds;
+    };
+
+    // GPU time spent rendering into a renderbuffer, asset id 0 is the main framebuffer.
+    struct RenderbufferTiming
+    {
+        AssetId assetId;
+        u64 nanoseconds;
+    };
+
+    // Timer queries are read back without waiting, so these describe the frame that finished frameLatency frames ago.
+    struct GpuTimerStats
+    {
+        u64 frameNanoseconds;
+        u64 frameLatency;
+        std::vector<RenderbufferTiming> renderbuffers;
+    };
+
+    struct FrameStats
+    {
+        StateChangeStats programBinds;
+        StateChangeStats textureBinds;
+        StateChangeStats vertexArrayBinds;
+        StateChangeStats framebufferBinds;
+        StateChangeStats blendChanges;
+        StateChangeStats viewportChanges;
+
+        // Capacities are per ring region, high-water marks are the largest single upload so far, both in bytes.
+        StreamBufferStats vertexStream;
+        StreamBufferStats indexStream;
+        StreamBufferStats instanceStream;
+
+        OcclusionStats opaquePass;
+        GpuTimerStats gpuTime;
+
+        SubmissionStats submission;
+        u64 renderbufferPushes;
+        PrimitiveStats primitives;
+        CpuTimeStats cpuTime;
+    };
+
+    // Describes the last completed frame, the counters restart at every beginDraw(). Thread-safe.
+    FrameStats getFrameStats();
+} // namespace processing
+
+namespace processing
+{
+    // Collects profile scopes of every thread until stopTrace() writes them as Chrome trace events,
+    // which chrome://tracing and Perfetto can open. Start and stop a trace from the same thread.
+    void startTrace(const std::filesystem::path& filepath);
+    void stopTrace();
+    bool isTracing();
+
+    // Times its own lifetime while a trace is running. The name must stay valid until stopTrace().
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char* name);
+        ~ProfileScope();
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* m_name;
+        u64 m_session;
+        u64 m_startNanoseconds;
+    };
+} // namespace processing
+
 namespace processing
 {
     void pushRenderbuffer(const Renderbuffer& renderbuffer);
@@ -660,6 +947,95 @@ namespace processing
     void image(const Image& img, f32 x1, f32 y1, f32 x2, f32 y2, f32 sx1, f32 sy1, f32 sx2, f32 sy2);
 } // namespace processing
 
+namespace processing
+{
+    // Records drawing calls without touching the graphics state, so every thread can fill its own
+    // encoder. Submitted encoders are executed on the main thread at the end of the frame, ordered
+    // by their order key, each starting from the default style and the identity matrix.
+    class CommandEncoder
+    {
+    public:
+        explicit CommandEncoder(u64 order = 0);
+        ~CommandEncoder();
+
+        CommandEncoder(CommandEncoder&& other) noexcept;
+        CommandEncoder& operator=(CommandEncoder&& other) noexcept;
+
+        void pushRenderbuffer(const Renderbuffer& renderbuffer);
+        void popRenderbuffer();
+
+        void pushStyle(bool extendPreviousStyle = true);
+        void popStyle();
+
+        void pushMatrix(bool extendPreviousMatrix = true);
+        void popMatrix();
+        void resetMatrix();
+        void resetMatrix(const matrix4x4& matrix);
+        void translate(f32 x, f32 y);
+        void scale(f32 x, f32 y);
+        void rotate(f32 rotation);
+
+        void blendMode(BlendMode mode);
+        void angleMode(AngleMode mode);
+        void rectMode(RectMode mode);
+        void ellipseMode(EllipseMode mode);
+        void imageMode(RectMode mode);
+        void imageSourceMode(ImageSourceMode mode);
+
+        void shader(const Shader& shader);
+        void noShader();
+        // Uniforms take effect for the draws recorded after them.
+        void setUniform(const Shader& shader, i32 location, const UniformValue& value);
+
+        void fill(Color color);
+        void noFill();
+        void stroke(Color color);
+        void noStroke();
+        void strokeWeight(f32 strokeWeight);
+        void strokeCap(StrokeCap strokeCap);
+        void strokeJoin(StrokeJoin strokeJoin);
+        void tint(Color color);
+        void background(Color color);
+
+        void beginShape(ShapeMode mode);
+        void endShape(bool closed = true);
+        void vertex(f32 x, f32 y);
+        void vertex(f32 x, f32 y, f32 u, f32 v);
+        void bezierVertex(f32 x2, f32 y2, f32 x3, f32 y3, f32 x4, f32 y4);
+        void quadraticVertex(f32 cx, f32 cy, f32 x3, f32 y3);
+        void curveVertex(f32 x, f32 y);
+
+        void rect(f32 x1, f32 y1, f32 x2, f32 y2);
+        void ellipse(f32 x1, f32 y1, f32 x2, f32 y2);
+        void circle(f32 x1, f32 y1, f32 xy2);
+        void triangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3);
+        void point(f32 x, f32 y);
+        void line(f32 x1, f32 y1, f32 x2, f32 y2);
+        void image(const Image& img, f32 x1, f32 y1, f32 x2, f32 y2);
+        void image(const Image& img, f32 x1, f32 y1, f32 x2, f32 y2, f32 sx1, f32 sy1, f32 sx2, f32 sy2);
+        void drawRecording(const Recording& recording);
+        void submitCommands(CommandEncoder encoder);
+
+        // Runs the recorded calls against the global graphics state, which only the main thread may do.
+        void execute() const;
+
+        // Drops the recorded calls but keeps their storage for the next frame.
+        void clear();
+
+        u64 getOrder() const;
+        usize getCommandCount() const;
+
+    private:
+        struct Command;
+
+        u64 m_order;
+        std::vector<Command> m_commands;
+    };
+
+    // Thread-safe. Encoders submitted after the frame has ended are executed with the next one.
+    void submitCommands(CommandEncoder encoder);
+} // namespace processing
+
 #endif // _PROCESSING_INCLUDE_PROCESSING_HPP_
 
 #ifndef _PROCESSING_INCLUDE_PROCESSING_INL_
@@ -0,0 +1,360 @@
+#include <processing/processing.hpp>
+
+namespace processing
+{
+    struct PushRenderbufferCommand
+    {
+        Renderbuffer renderbuffer;
+    };
+
+    struct PopRenderbufferCommand
+    {
+    };
+
+    struct PushStyleCommand
+    {
+        bool extendPreviousStyle;
+    };
+
+    struct PopStyleCommand
+    {
+    };
+
+    struct PushMatrixCommand
+    {
+        bool extendPreviousMatrix;
+    };
+
+    struct PopMatrixCommand
+    {
+    };
+
+    struct ResetMatrixCommand
+    {
+        matrix4x4 matrix;
+    };
+
+    struct TranslateCommand
+    {
+        f32 x, y;
+    };
+
+    struct ScaleCommand
+    {
+        f32 x, y;
+    };
+
+    struct RotateCommand
+    {
+        f32 rotation;
+    };
+
+    struct BlendModeCommand
+    {
+        BlendMode mode;
+    };
+
+    struct AngleModeCommand
+    {
+        AngleMode mode;
+    };
+
+    struct RectModeCommand
+    {
+        RectMode mode;
+    };
+
+    struct EllipseModeCommand
+    {
+        EllipseMode mode;
+    };
+
+    struct ImageModeCommand
+    {
+        RectMode mode;
+    };
+
+    struct ImageSourceModeCommand
+    {
+        ImageSourceMode mode;
+    };
+
+    struct ShaderCommand
+    {
+        std::optional<Shader> shader;
+    };
+
+    struct UniformCommand
+    {
+        Shader shader;
+        i32 location;
+        UniformValue value;
+    };
+
+    struct FillCommand
+    {
+        std::optional<Color> color;
+    };
+
+    struct StrokeCommand
+    {
+        std::optional<Color> color;
+    };
+
+    struct StrokeWeightCommand
+    {
+        f32 strokeWeight;
+    };
+
+    struct StrokeCapCommand
+    {
+        StrokeCap strokeCap;
+    };
+
+    struct StrokeJoinCommand
+    {
+        StrokeJoin strokeJoin;
+    };
+
+    struct TintCommand
+    {
+        Color color;
+    };
+
+    struct BackgroundCommand
+    {
+        Color color;
+    };
+
+    struct BeginShapeCommand
+    {
+        ShapeMode mode;
+    };
+
+    struct EndShapeCommand
+    {
+        bool closed;
+    };
+
+    struct VertexCommand
+    {
+        f32 x, y;
+        std::optional<float2> texcoord;
+    };
+
+    struct BezierVertexCommand
+    {
+        f32 x2, y2, x3, y3, x4, y4;
+    };
+
+    struct QuadraticVertexCommand
+    {
+        f32 cx, cy, x3, y3;
+    };
+
+    struct CurveVertexCommand
+    {
+        f32 x, y;
+    };
+
+    struct RectCommand
+    {
+        f32 x1, y1, x2, y2;
+    };
+
+    struct EllipseCommand
+    {
+        f32 x1, y1, x2, y2;
+    };
+
+    struct TriangleCommand
+    {
+        f32 x1, y1, x2, y2, x3, y3;
+    };
+
+    struct PointCommand
+    {
+        f32 x, y;
+    };
+
+    struct LineCommand
+    {
+        f32 x1, y1, x2, y2;
+    };
+
+    struct ImageCommand
+    {
+        Image image;
+        f32 x1, y1, x2, y2;
+    };
+
+    struct ImageRegionCommand
+    {
+        Image image;
+        f32 x1, y1, x2, y2;
+        f32 sx1, sy1, sx2, sy2;
+    };
+
+    struct DrawRecordingCommand
+    {
+        Recording recording;
+    };
+
+    // Executing hands the encoder on to the main thread queue. Frames run once before they are
+    // recycled, so it is moved out through the pointer although execute() only sees const commands.
+    struct SubmitCommandsCommand
+    {
+        std::shared_ptr<CommandEncoder> encoder;
+    };
+
+    struct CommandEncoder::Command
+    {
+        std::variant<
+            PushRenderbufferCommand, PopRenderbufferCommand, PushStyleCommand, PopStyleCommand,
+            PushMatrixCommand, PopMatrixCommand, ResetMatrixCommand, TranslateCommand, ScaleCommand, RotateCommand,
+            BlendModeCommand, AngleModeCommand, RectModeCommand, EllipseModeCommand, ImageModeCommand, ImageSourceModeCommand, ShaderCommand,
+            UniformCommand, FillCommand, StrokeCommand, StrokeWeightCommand, StrokeCapCommand, StrokeJoinCommand, TintCommand, BackgroundCommand,
+            BeginShapeCommand, EndShapeCommand, VertexCommand, BezierVertexCommand, QuadraticVertexCommand, CurveVertexCommand,
+            RectCommand, EllipseCommand, TriangleCommand, PointCommand, LineCommand, ImageCommand, ImageRegionCommand, DrawRecordingCommand,
+            SubmitCommandsCommand>
+            value;
+    };
+} // namespace processing
+
+namespace processing
+{
+    // clang-format off
+    inline static void execute(const PushRenderbufferCommand& command) { pushRenderbuffer(command.renderbuffer); }
+    inline static void execute(const PopRenderbufferCommand&) { popRenderbuffer(); }
+    inline static void execute(const PushStyleCommand& command) { pushStyle(command.extendPreviousStyle); }
+    inline static void execute(const PopStyleCommand&) { popStyle(); }
+    inline static void execute(const PushMatrixCommand& command) { pushMatrix(command.extendPreviousMatrix); }
+    inline static void execute(const PopMatrixCommand&) { popMatrix(); }
+    inline static void execute(const ResetMatrixCommand& command) { resetMatrix(command.matrix); }
+    inline static void execute(const TranslateCommand& command) { translate(command.x, command.y); }
+    inline static void execute(const ScaleCommand& command) { scale(command.x, command.y); }
+    inline static void execute(const RotateCommand& command) { rotate(command.rotation); }
+    inline static void execute(const BlendModeCommand& command) { blendMode(command.mode); }
+    inline static void execute(const AngleModeCommand& command) { angleMode(command.mode); }
+    inline static void execute(const RectModeCommand& command) { rectMode(command.mode); }
+    inline static void execute(const EllipseModeCommand& command) { ellipseMode(command.mode); }
+    inline static void execute(const ImageModeCommand& command) { imageMode(command.mode); }
+    inline static void execute(const ImageSourceModeCommand& command) { imageSourceMode(command.mode); }
+    inline static void execute(const ShaderCommand& command) { command.shader.has_value() ? shader(*command.shader) : noShader(); }
+    inline static void execute(UniformCommand command) { command.shader.setUniformAt(command.location, command.value); }
+    inline static void execute(const FillCommand& command) { command.color.has_value() ? fill(*command.color) : noFill(); }
+    inline static void execute(const StrokeCommand& command) { command.color.has_value() ? stroke(*command.color) : noStroke(); }
+    inline static void execute(const StrokeWeightCommand& command) { strokeWeight(command.strokeWeight); }
+    inline static void execute(const StrokeCapCommand& command) { strokeCap(command.strokeCap); }
+    inline static void execute(const StrokeJoinCommand& command) { strokeJoin(command.strokeJoin); }
+    inline static void execute(const TintCommand& command) { tint(command.color); }
+    inline static void execute(const BackgroundCommand& command) { background(command.color); }
+    inline static void execute(const BeginShapeCommand& command) { beginShape(command.mode); }
+    inline static void execute(const EndShapeCommand& command) { endShape(command.closed); }
+    inline static void execute(const VertexCommand& command) { command.texcoord.has_value() ? vertex(command.x, command.y, command.texcoord->x, command.texcoord->y) : vertex(command.x, command.y); }
+    inline static void execute(const BezierVertexCommand& command) { bezierVertex(command.x2, command.y2, command.x3, command.y3, command.x4, command.y4); }
+    inline static void execute(const QuadraticVertexCommand& command) { quadraticVertex(command.cx, command.cy, command.x3, command.y3); }
+    inline static void execute(const CurveVertexCommand& command) { curveVertex(command.x, command.y); }
+    inline static void execute(const RectCommand& command) { rect(command.x1, command.y1, command.x2, command.y2); }
+    inline static void execute(const EllipseCommand& command) { ellipse(command.x1, command.y1, command.x2, command.y2); }
+    inline static void execute(const TriangleCommand& command) { triangle(command.x1, command.y1, command.x2, command.y2, command.x3, command.y3); }
+    inline static void execute(const PointCommand& command) { point(command.x, command.y); }
+    inline static void execute(const LineCommand& command) { line(command.x1, command.y1, command.x2, command.y2); }
+    inline static void execute(const ImageCommand& command) { image(command.image, command.x1, command.y1, command.x2, command.y2); }
+    inline static void execute(const ImageRegionCommand& command) { image(command.image, command.x1, command.y1, command.x2, command.y2, command.sx1, command.sy1, command.sx2, command.sy2); }
+    inline static void execute(const DrawRecordingCommand& command) { drawRecording(command.recording); }
+    inline static void execute(const SubmitCommandsCommand& command) { submitCommands(std::move(*command.encoder)); }
+    // clang-format on
+} // namespace processing
+
+namespace processing
+{
+    CommandEncoder::CommandEncoder(const u64 order)
+        : m_order(order),
+          m_commands()
+    {
+    }
+
+    CommandEncoder::~CommandEncoder() = default;
+    CommandEncoder::CommandEncoder(CommandEncoder&& other) noexcept = default;
+    CommandEncoder& CommandEncoder::operator=(CommandEncoder&& other) noexcept = default;
+
+    // clang-format off
+    void CommandEncoder::pushRenderbuffer(const Renderbuffer& renderbuffer) { m_commands.push_back(Command{PushRenderbufferCommand{renderbuffer}}); }
+    void CommandEncoder::popRenderbuffer() { m_commands.push_back(Command{PopRenderbufferCommand{}}); }
+
+    void CommandEncoder::pushStyle(const bool extendPreviousStyle) { m_commands.push_back(Command{PushStyleCommand{extendPreviousStyle}}); }
+    void CommandEncoder::popStyle() { m_commands.push_back(Command{PopStyleCommand{}}); }
+
+    void CommandEncoder::pushMatrix(const bool extendPreviousMatrix) { m_commands.push_back(Command{PushMatrixCommand{extendPreviousMatrix}}); }
+    void CommandEncoder::popMatrix() { m_commands.push_back(Command{PopMatrixCommand{}}); }
+    void CommandEncoder::resetMatrix() { m_commands.push_back(Command{ResetMatrixCommand{matrix4x4::identity}}); }
+    void CommandEncoder::resetMatrix(const matrix4x4& matrix) { m_commands.push_back(Command{ResetMatrixCommand{matrix}}); }
+    void CommandEncoder::translate(const f32 x, const f32 y) { m_commands.push_back(Command{TranslateCommand{x, y}}); }
+    void CommandEncoder::scale(const f32 x, const f32 y) { m_commands.push_back(Command{ScaleCommand{x, y}}); }
+    void CommandEncoder::rotate(const f32 rotation) { m_commands.push_back(Command{RotateCommand{rotation}}); }
+
+    void CommandEncoder::blendMode(const BlendMode mode) { m_commands.push_back(Command{BlendModeCommand{mode}}); }
+    void CommandEncoder::angleMode(const AngleMode mode) { m_commands.push_back(Command{AngleModeCommand{mode}}); }
+    void CommandEncoder::rectMode(const RectMode mode) { m_commands.push_back(Command{RectModeCommand{mode}}); }
+    void CommandEncoder::ellipseMode(const EllipseMode mode) { m_commands.push_back(Command{EllipseModeCommand{mode}}); }
+    void CommandEncoder::imageMode(const RectMode mode) { m_commands.push_back(Command{ImageModeCommand{mode}}); }
+    void CommandEncoder::imageSourceMode(const ImageSourceMode mode) { m_commands.push_back(Command{ImageSourceModeCommand{mode}}); }
+
+    void CommandEncoder::shader(const Shader& shader) { m_commands.push_back(Command{ShaderCommand{shader}}); }
+    void CommandEncoder::noShader() { m_commands.push_back(Command{ShaderCommand{std::nullopt}}); }
+    void CommandEncoder::setUniform(const Shader& shader, const i32 location, const UniformValue& value) { m_commands.push_back(Command{UniformCommand{shader, location, value}}); }
+
+    void CommandEncoder::fill(const Color color) { m_commands.push_back(Command{FillCommand{color}}); }
+    void CommandEncoder::noFill() { m_commands.push_back(Command{FillCommand{std::nullopt}}); }
+    void CommandEncoder::stroke(const Color color) { m_commands.push_back(Command{StrokeCommand{color}}); }
+    void CommandEncoder::noStroke() { m_commands.push_back(Command{StrokeCommand{std::nullopt}}); }
+    void CommandEncoder::strokeWeight(const f32 strokeWeight) { m_commands.push_back(Command{StrokeWeightCommand{strokeWeight}}); }
+    void CommandEncoder::strokeCap(const StrokeCap strokeCap) { m_commands.push_back(Command{StrokeCapCommand{strokeCap}}); }
+    void CommandEncoder::strokeJoin(const StrokeJoin strokeJoin) { m_commands.push_back(Command{StrokeJoinCommand{strokeJoin}}); }
+    void CommandEncoder::tint(const Color color) { m_commands.push_back(Command{TintCommand{color}}); }
+    void CommandEncoder::background(const Color color) { m_commands.push_back(Command{BackgroundCommand{color}}); }
+
+    void CommandEncoder::beginShape(const ShapeMode mode) { m_commands.push_back(Command{BeginShapeCommand{mode}}); }
+    void CommandEncoder::endShape(const bool closed) { m_commands.push_back(Command{EndShapeCommand{closed}}); }
+    void CommandEncoder::vertex(const f32 x, const f32 y) { m_commands.push_back(Command{VertexCommand{x, y, std::nullopt}}); }
+    void CommandEncoder::vertex(const f32 x, const f32 y, const f32 u, const f32 v) { m_commands.push_back(Command{VertexCommand{x, y, float2{u, v}}}); }
+    void CommandEncoder::bezierVertex(const f32 x2, const f32 y2, const f32 x3, const f32 y3, const f32 x4, const f32 y4) { m_commands.push_back(Command{BezierVertexCommand{x2, y2, x3, y3, x4, y4}}); }
+    void CommandEncoder::quadraticVertex(const f32 cx, const f32 cy, const f32 x3, const f32 y3) { m_commands.push_back(Command{QuadraticVertexCommand{cx, cy, x3, y3}}); }
+    void CommandEncoder::curveVertex(const f32 x, const f32 y) { m_commands.push_back(Command{CurveVertexCommand{x, y}}); }
+
+    void CommandEncoder::rect(const f32 x1, const f32 y1, const f32 x2, const f32 y2) { m_commands.push_back(Command{RectCommand{x1, y1, x2, y2}}); }
+    void CommandEncoder::ellipse(const f32 x1, const f32 y1, const f32 x2, const f32 y2) { m_commands.push_back(Command{EllipseCommand{x1, y1, x2, y2}}); }
+    void CommandEncoder::circle(const f32 x1, const f32 y1, const f32 xy2) { m_commands.push_back(Command{EllipseCommand{x1, y1, xy2, xy2}}); }
+    void CommandEncoder::triangle(const f32 x1, const f32 y1, const f32 x2, const f32 y2, const f32 x3, const f32 y3) { m_commands.push_back(Command{TriangleCommand{x1, y1, x2, y2, x3, y3}}); }
+    void CommandEncoder::point(const f32 x, const f32 y) { m_commands.push_back(Command{PointCommand{x, y}}); }
+    void CommandEncoder::line(const f32 x1, const f32 y1, const f32 x2, const f32 y2) { m_commands.push_back(Command{LineCommand{x1, y1, x2, y2}}); }
+    void CommandEncoder::image(const Image& img, const f32 x1, const f32 y1, const f32 x2, const f32 y2) { m_commands.push_back(Command{ImageCommand{img, x1, y1, x2, y2}}); }
+    void CommandEncoder::image(const Image& img, const f32 x1, const f32 y1, const f32 x2, const f32 y2, const f32 sx1, const f32 sy1, const f32 sx2, const f32 sy2) { m_commands.push_back(Command{ImageRegionCommand{img, x1, y1, x2, y2, sx1, sy1, sx2, sy2}}); }
+    void CommandEncoder::drawRecording(const Recording& recording) { m_commands.push_back(Command{DrawRecordingCommand{recording}}); }
+    void CommandEncoder::submitCommands(CommandEncoder encoder) { m_commands.push_back(Command{SubmitCommandsCommand{std::make_shared<CommandEncoder>(std::move(encoder))}}); }
+    // clang-format on
+
+    void CommandEncoder::execute() const
+    {
+        for (const Command& command : m_commands)
+        {
+            std::visit([](const auto& value) { processing::execute(value); }, command.value);
+        }
+    }
+
+    void CommandEncoder::clear()
+    {
+        m_commands.clear();
+    }
+
+    u64 CommandEncoder::getOrder() const
+    {
+        return m_order;
+    }
+
+    usize CommandEncoder::getCommandCount() const
+    {
+        return m_commands.size();
+    }
+} // namespace processing
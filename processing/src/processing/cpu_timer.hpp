@@ -0,0 +1,45 @@
+#ifndef _PROCESSING_INCLUDE_CPU_TIMER_HPP_
+#define _PROCESSING_INCLUDE_CPU_TIMER_HPP_
+
+#include <processing/processing.hpp>
+
+#include <chrono>
+
+namespace processing
+{
+    // Adds the time until the end of the scope to a nanosecond counter.
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(u64& nanoseconds);
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        u64& m_nanoseconds;
+        std::chrono::steady_clock::time_point m_start;
+    };
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_CPU_TIMER_HPP_
+
+#ifndef _PROCESSING_INCLUDE_CPU_TIMER_INL_
+#define _PROCESSING_INCLUDE_CPU_TIMER_INL_
+
+namespace processing
+{
+    inline ScopedTimer::ScopedTimer(u64& nanoseconds)
+        : m_nanoseconds(nanoseconds),
+          m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    inline ScopedTimer::~ScopedTimer()
+    {
+        m_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_CPU_TIMER_INL_
@@ -0,0 +1,140 @@
+#include <processing/frame_pipeline.hpp>
+
+#include <algorithm>
+
+namespace processing
+{
+    std::unique_ptr<InputQueue> InputQueue::create()
+    {
+        return std::unique_ptr<InputQueue>(new InputQueue());
+    }
+
+    bool InputQueue::push(const InputEvent& event)
+    {
+        const usize writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+        if (writeIndex - m_readIndex.load(std::memory_order_acquire) == CAPACITY)
+        {
+            return false;
+        }
+
+        m_events[writeIndex % CAPACITY] = event;
+        m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<InputEvent> InputQueue::pop()
+    {
+        const usize readIndex = m_readIndex.load(std::memory_order_relaxed);
+        if (readIndex == m_writeIndex.load(std::memory_order_acquire))
+        {
+            return std::nullopt;
+        }
+
+        const InputEvent event = m_events[readIndex % CAPACITY];
+        m_readIndex.store(readIndex + 1, std::memory_order_release);
+        return event;
+    }
+
+    InputQueue::InputQueue()
+        : m_events(),
+          m_readIndex(0),
+          m_writeIndex(0)
+    {
+    }
+} // namespace processing
+
+namespace processing
+{
+    std::unique_ptr<FrameQueue> FrameQueue::create(const u32 maxFramesInFlight)
+    {
+        return std::unique_ptr<FrameQueue>(new FrameQueue(std::max(maxFramesInFlight, 1u)));
+    }
+
+    std::optional<CommandEncoder> FrameQueue::acquire()
+    {
+        std::unique_lock lock(m_mutex);
+        m_slotAvailable.wait(lock, [this] { return m_isClosed or m_framesInFlight < m_maxFramesInFlight; });
+
+        if (m_isClosed)
+        {
+            return std::nullopt;
+        }
+
+        ++m_framesInFlight;
+
+        if (m_recycledFrames.empty())
+        {
+            return CommandEncoder{};
+        }
+
+        // Recycled encoders keep the command storage of earlier frames.
+        CommandEncoder frame = std::move(m_recycledFrames.back());
+        m_recycledFrames.pop_back();
+        return frame;
+    }
+
+    void FrameQueue::submit(CommandEncoder frame)
+    {
+        {
+            const std::lock_guard lock(m_mutex);
+            m_submittedFrames.push_back(std::move(frame));
+        }
+
+        m_frameAvailable.notify_one();
+    }
+
+    std::optional<CommandEncoder> FrameQueue::pop(const std::chrono::milliseconds timeout)
+    {
+        std::unique_lock lock(m_mutex);
+        if (not m_frameAvailable.wait_for(lock, timeout, [this] { return not m_submittedFrames.empty(); }))
+        {
+            return std::nullopt;
+        }
+
+        CommandEncoder frame = std::move(m_submittedFrames.front());
+        m_submittedFrames.pop_front();
+        return frame;
+    }
+
+    void FrameQueue::recycle(CommandEncoder frame)
+    {
+        frame.clear();
+
+        {
+            const std::lock_guard lock(m_mutex);
+            m_recycledFrames.push_back(std::move(frame));
+            --m_framesInFlight;
+        }
+
+        m_slotAvailable.notify_one();
+    }
+
+    void FrameQueue::close()
+    {
+        {
+            const std::lock_guard lock(m_mutex);
+            m_isClosed = true;
+        }
+
+        m_slotAvailable.notify_all();
+        m_frameAvailable.notify_all();
+    }
+
+    bool FrameQueue::isDone()
+    {
+        const std::lock_guard lock(m_mutex);
+        return m_isClosed and m_submittedFrames.empty();
+    }
+
+    FrameQueue::FrameQueue(const u32 maxFramesInFlight)
+        : m_mutex(),
+          m_frameAvailable(),
+          m_slotAvailable(),
+          m_submittedFrames(),
+          m_recycledFrames(),
+          m_maxFramesInFlight(maxFramesInFlight),
+          m_framesInFlight(0),
+          m_isClosed(false)
+    {
+    }
+} // namespace processing
@@ -0,0 +1,82 @@
+#ifndef _PROCESSING_INCLUDE_FRAME_PIPELINE_HPP_
+#define _PROCESSING_INCLUDE_FRAME_PIPELINE_HPP_
+
+#include <processing/processing.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace processing
+{
+    enum class InputEventType
+    {
+        mouseMoved,
+        windowClosed,
+    };
+
+    struct InputEvent
+    {
+        InputEventType type;
+        int2 position;
+    };
+
+    // Lock-free ring for a single producer and a single consumer. The main thread pushes the
+    // window events it polls, the sketch thread pops them before recording a frame.
+    class InputQueue
+    {
+    public:
+        static constexpr usize CAPACITY = 1024;
+
+        static std::unique_ptr<InputQueue> create();
+
+        bool push(const InputEvent& event);
+        std::optional<InputEvent> pop();
+
+    private:
+        InputQueue();
+
+        std::array<InputEvent, CAPACITY> m_events;
+        std::atomic<usize> m_readIndex;
+        std::atomic<usize> m_writeIndex;
+    };
+} // namespace processing
+
+namespace processing
+{
+    // Hands recorded frames from the sketch thread to the main thread. A frame counts as in flight
+    // from acquire() until it is recycled after presentation, so the sketch can run at most
+    // maxFramesInFlight - 1 frames ahead of the one being submitted.
+    class FrameQueue
+    {
+    public:
+        static std::unique_ptr<FrameQueue> create(u32 maxFramesInFlight);
+
+        std::optional<CommandEncoder> acquire();
+        void submit(CommandEncoder frame);
+
+        std::optional<CommandEncoder> pop(std::chrono::milliseconds timeout);
+        void recycle(CommandEncoder frame);
+
+        void close();
+        bool isDone();
+
+    private:
+        explicit FrameQueue(u32 maxFramesInFlight);
+
+        std::mutex m_mutex;
+        std::condition_variable m_frameAvailable;
+        std::condition_variable m_slotAvailable;
+
+        std::deque<CommandEncoder> m_submittedFrames;
+        std::vector<CommandEncoder> m_recycledFrames;
+
+        u32 m_maxFramesInFlight;
+        u32 m_framesInFlight;
+        bool m_isClosed;
+    };
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_FRAME_PIPELINE_HPP_
@@ -1,4 +1,6 @@
 #include <processing/framebuffer.hpp>
+#include <processing/image.hpp>
+#include <processing/state_cache.hpp>
 
 #include <glad/gl.h>
 
@@ -11,9 +13,9 @@ namespace processing
         {
             ResourceId framebufferId = {.value = 0};
             glGenFramebuffers(1, &framebufferId.value);
-            glBindFramebuffer(GL_FRAMEBUFFER, framebufferId.value);
+            getStateCache().bindFramebuffer(framebufferId);
 
-            Image image = createImage(width, height, nullptr, filterMode, extendMode);
+            Image image = createStandaloneImage(width, height, nullptr, filterMode, extendMode);
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image.getResourceId().value, 0);
 
             ResourceId renderbufferId = {.value = 0};
@@ -22,7 +24,7 @@ namespace processing
             glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
             glBindRenderbuffer(GL_RENDERBUFFER, 0);
             glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbufferId.value);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            getStateCache().bindFramebuffer(ResourceId{.value = 0});
 
             return std::unique_ptr<OpenGLFramebuffer>(new OpenGLFramebuffer(uint2{width, height}, renderbufferId, framebufferId, image));
         }
@@ -30,6 +32,7 @@ namespace processing
         ~OpenGLFramebuffer() override
         {
             glDeleteFramebuffers(1, &m_framebufferId.value);
+            getStateCache().invalidateFramebuffer(m_framebufferId);
             glDeleteRenderbuffers(1, &m_renderbufferId.value);
         }
 
@@ -1,21 +1,15 @@
 #include <processing/graphics.hpp>
+#include <processing/cpu_timer.hpp>
 #include <processing/shape_builder.hpp>
+#include <processing/work_stealing_pool.hpp>
 
 #include <glad/gl.h>
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
 
-namespace processing
-{
-    void blit(u32 width, u32 height, const Framebuffer& fb)
-    {
-        glViewport(0, 0, width, height);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, fb.getResourceId().value);
-        glBlitFramebuffer(0, 0, fb.getSize().x, fb.getSize().y, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-    }
-} // namespace processing
-
 namespace processing
 {
     inline static constexpr f32 MIN_DEPTH = -1.0f;
@@ -30,6 +24,28 @@ namespace processing
         Color strokeColor;
     };
 
+    // A draw issued while contours are still being tessellated. Instances and ready contours wait
+    // behind them so the renderer receives every draw in call order.
+    struct QueuedDraw
+    {
+        std::optional<InstanceShape> shape;
+        Instance instance;
+        Contour contour;
+        matrix4x4 transform;
+        Color color;
+        f32 depth;
+        RenderState renderState;
+        u64 tessellationNanoseconds;
+    };
+
+    struct FrameCounters
+    {
+        u64 renderbufferPushes;
+        PrimitiveStats primitives;
+        u64 tessellationNanoseconds;
+        u64 vertexConversionNanoseconds;
+    };
+
     struct GraphicsData
     {
         std::unordered_map<usize, f32> depths;
@@ -45,10 +61,25 @@ namespace processing
         std::vector<ShapeBuilderPoint> points;
         std::vector<float2> curvePoints;
 
+        f32 recordStartDepth;
+
         std::shared_ptr<DefaultRenderer> renderer;
+
+        std::mutex encoderMutex;
+        std::vector<CommandEncoder> submittedEncoders;
+
+        std::unique_ptr<WorkStealingPool> tessellationPool;
+        std::deque<QueuedDraw> queuedDraws;
+
+        FrameCounters frameCounters;
+
+        // Read by the sketch thread in pipelined mode while the main thread finishes the next frame.
+        std::mutex frameStatsMutex;
+        FrameStats frameStats;
     };
 
     inline static std::unique_ptr<GraphicsData> s_graphics;
+    inline static thread_local CommandEncoder* s_frameEncoder = nullptr;
 
     // clang-format off
     AssetId peekAssetId() { return AssetId{ .value = s_graphics->assetIds.peek() }; }
@@ -57,6 +88,8 @@ namespace processing
     NeverEmptyStack<matrix4x4>& peekMetrics() { return s_graphics->metrics.at(peekAssetId().value); }
     Framebuffer& peekFramebuffer() { return s_graphics->framebuffers.at(peekAssetId().value); }
     // clang-format on
+
+    void submit_queued_draws();
 } // namespace processing
 
 namespace processing
@@ -89,6 +122,38 @@ namespace processing
     };
 } // namespace processing
 
+namespace processing
+{
+    class RecordingImpl : public PlatformRecording
+    {
+    public:
+        explicit RecordingImpl(std::shared_ptr<RecordedGeometry> geometry, const f32 depthRange)
+            : m_geometry{std::move(geometry)},
+              m_depthRange{depthRange}
+        {
+        }
+
+        virtual void draw() const override
+        {
+            // Replays claim as many depth values as the recorded draws did.
+            submit_queued_draws();
+
+            const f32 depth = peekDepth();
+            peekDepth() += m_depthRange;
+            s_graphics->renderer->renderRecording(*m_geometry, peekMatrix(), depth);
+        }
+
+        virtual usize getDrawCount() const override
+        {
+            return m_geometry->getDrawCount();
+        }
+
+    private:
+        std::shared_ptr<RecordedGeometry> m_geometry;
+        f32 m_depthRange;
+    };
+} // namespace processing
+
 namespace processing
 {
     void warnMemoryLeaks()
@@ -131,56 +196,132 @@ namespace processing
                 .shapeStarted = false,
                 .points = {},
                 .curvePoints = {},
+                .recordStartDepth = MIN_DEPTH,
                 .renderer = DefaultRenderer::create(),
+                .encoderMutex = {},
+                .submittedEncoders = {},
+                .tessellationPool = nullptr,
+                .queuedDraws = {},
+                .frameCounters = {},
+                .frameStatsMutex = {},
+                .frameStats = {},
             },
         };
     }
 
     void beginDraw()
     {
+        const ProfileScope scope("beginDraw");
+        s_graphics->frameCounters = FrameCounters{};
         peekDepth() = MIN_DEPTH;
-        s_graphics->renderer->beginDraw(peekFramebuffer());
+        s_graphics->renderer->beginFrame();
+        s_graphics->renderer->beginDraw(peekFramebuffer(), peekAssetId());
+    }
+
+    void executeSubmittedCommands()
+    {
+        std::vector<CommandEncoder> encoders;
+        {
+            const std::lock_guard lock(s_graphics->encoderMutex);
+            encoders.swap(s_graphics->submittedEncoders);
+        }
+
+        // Threads finish in any order, the order keys keep the output identical between runs.
+        std::ranges::stable_sort(encoders, {}, &CommandEncoder::getOrder);
+
+        for (const CommandEncoder& encoder : encoders)
+        {
+            pushStyle(false);
+            pushMatrix(false);
+            encoder.execute();
+            popMatrix();
+            popStyle();
+        }
     }
 
-    void endDraw(u32 width, u32 height)
+    void finishDraw(const std::optional<uint2>& windowSize)
     {
+        const ProfileScope scope("endDraw");
+        executeSubmittedCommands();
+        submit_queued_draws();
         warnMemoryLeaks();
         s_graphics->renderer->endDraw();
-        blit(width, height, peekFramebuffer());
+
+        if (windowSize.has_value())
+        {
+            s_graphics->renderer->blit(peekFramebuffer(), windowSize->x, windowSize->y);
+        }
+
+        s_graphics->renderer->endFrame();
+
+        const FrameCounters& counters = s_graphics->frameCounters;
+        FrameStats stats = s_graphics->renderer->getFrameStats();
+        stats.renderbufferPushes = counters.renderbufferPushes;
+        stats.primitives = counters.primitives;
+        stats.cpuTime.tessellationNanoseconds = counters.tessellationNanoseconds;
+        stats.cpuTime.vertexConversionNanoseconds = counters.vertexConversionNanoseconds;
+
+        const std::lock_guard lock(s_graphics->frameStatsMutex);
+        s_graphics->frameStats = std::move(stats);
     }
-} // namespace processing
 
-namespace processing
-{
-    static constexpr float4 float4_from_color(Color color)
+    void endDraw(const u32 width, const u32 height)
     {
-        return float4{
-            static_cast<float>(color.r) / 255.0f,
-            static_cast<float>(color.g) / 255.0f,
-            static_cast<float>(color.b) / 255.0f,
-            static_cast<float>(color.a) / 255.0f,
-        };
+        finishDraw(uint2{width, height});
     }
 
-    Vertices vertices_from_contour(const Contour& contour, const matrix4x4& transform, Color color, float depth)
+    void endDraw()
     {
-        Vertices shape;
-        shape.mode = VertexMode::triangles;
-        shape.vertices.reserve(contour.positions.size());
-        shape.indices.append_range(contour.indices);
-
-        const float4 col = float4_from_color(color);
+        finishDraw(std::nullopt);
+    }
 
-        for (size_t i = 0; i < contour.positions.size(); ++i)
+    void flushPendingDraws()
+    {
+        if (s_graphics != nullptr)
         {
-            shape.vertices.push_back(Vertex{
-                .position = float3{transform.transformPoint(contour.positions[i]), depth},
-                .texcoord = contour.texcoords[i],
-                .color = col,
-            });
+            submit_queued_draws();
+            s_graphics->renderer->flush();
         }
+    }
+
+    void beginFrameEncoding(CommandEncoder& encoder)
+    {
+        s_frameEncoder = &encoder;
+    }
+
+    void endFrameEncoding()
+    {
+        s_frameEncoder = nullptr;
+    }
 
-        return shape;
+    CommandEncoder* getFrameEncoder()
+    {
+        return s_frameEncoder;
+    }
+} // namespace processing
+
+namespace processing
+{
+    Instance instance_from_rect(const rect2f& boundary, const matrix4x4& transform, const rect2f& texRect, Color color, float depth)
+    {
+        const float2 origin = transform.transformPoint(boundary.position);
+        const float2 right = transform.transformPoint(float2{boundary.right(), boundary.top});
+        const float2 bottom = transform.transformPoint(float2{boundary.left, boundary.bottom()});
+
+        return Instance{
+            .origin = origin,
+            .axisX = right - origin,
+            .axisY = bottom - origin,
+            .depth = depth,
+            .texRect = texRect,
+            .color = color,
+        };
+    }
+
+    // Images are stored bottom-up, so the top of the destination samples the bottom of the source rectangle.
+    inline static rect2f flip_source_rect(const rect2f& source)
+    {
+        return rect2f{source.left, source.top + source.height, source.width, -source.height};
     }
 } // namespace processing
 
@@ -198,6 +339,16 @@ namespace processing
         }
     }
 
+    inline static rect2f remap_to_region(const rect2f& source, const rect2f& region)
+    {
+        return rect2f{
+            region.left + source.left * region.width,
+            region.top + source.top * region.height,
+            source.width * region.width,
+            source.height * region.height,
+        };
+    }
+
     inline static constexpr rect2f image_source_to_rect(const ImageSourceMode mode, f32 imgWidth, f32 imgHeight, f32 x1, f32 y1, f32 x2, f32 y2)
     {
         switch (mode)
@@ -260,21 +411,188 @@ namespace processing
     RenderState getRenderState(const std::optional<Image>& image = std::nullopt)
     {
         const RenderStyle& style = peekStyle();
-        const Framebuffer& framebuffer = peekFramebuffer();
 
         return RenderState{
             .blendMode = style.blendMode,
             .shader = style.shader,
             .image = image,
-            .transform = matrix4x4::orthographic(0.0f, 0.0f, framebuffer.getSize().x, framebuffer.getSize().y, -1.0f, 1.0f),
+            .transform = std::nullopt,
         };
     }
+
+    void render_contour(const Contour& contour, const matrix4x4& transform, Color color, float depth, const RenderState& renderState)
+    {
+        Vertices vertices;
+        RenderState localState = renderState;
+
+        {
+            const ScopedTimer timer(s_graphics->frameCounters.vertexConversionNanoseconds);
+
+            if (isHintEnabled(Hint::gpuTransforms))
+            {
+                localState.transform = transform;
+                vertices = vertices_from_contour(contour, color, depth);
+            }
+            else
+            {
+                vertices = vertices_from_contour(contour, transform, color, depth);
+            }
+        }
+
+        s_graphics->renderer->render(vertices, localState);
+    }
+
+    // Uniforms are committed when a draw reaches the renderer, so draws with a custom shader must not
+    // wait in the queue. Drains it for them and returns whether the draw has to be rendered inline.
+    bool submit_queued_draws_for_shader(const RenderState& renderState)
+    {
+        if (not renderState.shader.has_value())
+        {
+            return false;
+        }
+
+        submit_queued_draws();
+        return true;
+    }
+
+    void render_contour(const Contour& contour, const matrix4x4& transform, Color color, float depth)
+    {
+        const RenderState renderState = getRenderState();
+
+        if (not submit_queued_draws_for_shader(renderState) and not s_graphics->queuedDraws.empty())
+        {
+            s_graphics->queuedDraws.push_back(QueuedDraw{
+                .shape = std::nullopt,
+                .instance = {},
+                .contour = contour,
+                .transform = transform,
+                .color = color,
+                .depth = depth,
+                .renderState = renderState,
+                .tessellationNanoseconds = 0,
+            });
+
+            return;
+        }
+
+        render_contour(contour, transform, color, depth, renderState);
+    }
+
+    void render_instance(const InstanceShape shape, const Instance& instance, const RenderState& renderState)
+    {
+        if (not submit_queued_draws_for_shader(renderState) and not s_graphics->queuedDraws.empty())
+        {
+            s_graphics->queuedDraws.push_back(QueuedDraw{
+                .shape = shape,
+                .instance = instance,
+                .contour = {},
+                .transform = matrix4x4::identity,
+                .color = instance.color,
+                .depth = instance.depth,
+                .renderState = renderState,
+                .tessellationNanoseconds = 0,
+            });
+
+            return;
+        }
+
+        s_graphics->renderer->renderInstance(shape, instance, renderState);
+    }
+
+    template <typename Tessellate>
+    Contour tessellate_timed(Tessellate&& tessellate)
+    {
+        const ProfileScope scope("tessellate");
+        const ScopedTimer timer(s_graphics->frameCounters.tessellationNanoseconds);
+        return tessellate();
+    }
+
+    // Hands the tessellation to the worker pool when Hint::parallelTessellation is enabled. The queued
+    // slot keeps its position, so the draw order does not depend on which worker finishes first.
+    template <typename Tessellate>
+    void render_tessellated(Tessellate&& tessellate, const matrix4x4& transform, Color color, float depth)
+    {
+        const RenderState renderState = getRenderState();
+
+        if (submit_queued_draws_for_shader(renderState) or not isHintEnabled(Hint::parallelTessellation))
+        {
+            submit_queued_draws();
+            render_contour(tessellate_timed(tessellate), transform, color, depth, renderState);
+            return;
+        }
+
+        if (s_graphics->tessellationPool == nullptr)
+        {
+            s_graphics->tessellationPool = WorkStealingPool::create(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        }
+
+        QueuedDraw& draw = s_graphics->queuedDraws.emplace_back(QueuedDraw{
+            .shape = std::nullopt,
+            .instance = {},
+            .contour = {},
+            .transform = transform,
+            .color = color,
+            .depth = depth,
+            .renderState = renderState,
+            .tessellationNanoseconds = 0,
+        });
+
+        // Deque elements keep their address while more draws are appended behind them.
+        s_graphics->tessellationPool->submit([&draw, tessellate = std::forward<Tessellate>(tessellate)]
+        {
+            const ProfileScope scope("tessellate");
+            const ScopedTimer timer(draw.tessellationNanoseconds);
+            draw.contour = tessellate();
+        });
+    }
+
+    void submit_queued_draws()
+    {
+        if (s_graphics->queuedDraws.empty())
+        {
+            return;
+        }
+
+        s_graphics->tessellationPool->wait();
+
+        for (const QueuedDraw& draw : s_graphics->queuedDraws)
+        {
+            s_graphics->frameCounters.tessellationNanoseconds += draw.tessellationNanoseconds;
+
+            if (draw.shape.has_value())
+            {
+                s_graphics->renderer->renderInstance(*draw.shape, draw.instance, draw.renderState);
+            }
+            else
+            {
+                render_contour(draw.contour, draw.transform, draw.color, draw.depth, draw.renderState);
+            }
+        }
+
+        s_graphics->queuedDraws.clear();
+    }
+} // namespace processing
+
+namespace processing
+{
+    FrameStats getFrameStats()
+    {
+        const std::lock_guard lock(s_graphics->frameStatsMutex);
+        return s_graphics->frameStats;
+    }
 } // namespace processing
 
 namespace processing
 {
     Renderbuffer createRenderbuffer(const u32 width, const u32 height, const FilterMode filterMode, const ExtendMode extendMode)
     {
+        if (s_frameEncoder != nullptr)
+        {
+            fprintf(stdout, "Renderbuffers cannot be created while a pipelined frame is recorded");
+            fflush(stdout);
+            return Renderbuffer{};
+        }
+
         const AssetId newAssetId = {.value = s_graphics->nextAssetId};
         s_graphics->depths.emplace(std::make_pair(newAssetId.value, MIN_DEPTH));
         s_graphics->renderStyles.emplace(std::make_pair(newAssetId.value, NeverEmptyStack<RenderStyle>{RenderStyle()}));
@@ -286,11 +604,92 @@ namespace processing
     }
 } // namespace processing
 
+namespace processing
+{
+    void beginRecord()
+    {
+        if (s_frameEncoder != nullptr)
+        {
+            fprintf(stdout, "Recordings cannot be made while a pipelined frame is recorded");
+            fflush(stdout);
+            return;
+        }
+
+        if (s_graphics->renderer->isRecording())
+        {
+            fprintf(stdout, "A recording is already in progress");
+            fflush(stdout);
+            return;
+        }
+
+        submit_queued_draws();
+        s_graphics->recordStartDepth = peekDepth();
+        s_graphics->renderer->beginRecording(peekDepth());
+    }
+
+    Recording endRecord()
+    {
+        if (s_frameEncoder != nullptr)
+        {
+            return Recording{};
+        }
+
+        submit_queued_draws();
+        std::shared_ptr<RecordedGeometry> geometry = s_graphics->renderer->endRecording();
+        if (geometry == nullptr)
+        {
+            return Recording{};
+        }
+
+        // Nothing has been drawn, the depth values are handed out again on every replay.
+        const f32 depthRange = peekDepth() - s_graphics->recordStartDepth;
+        peekDepth() = s_graphics->recordStartDepth;
+
+        return Recording{std::make_shared<RecordingImpl>(std::move(geometry), depthRange)};
+    }
+
+    void drawRecording(const Recording& recording)
+    {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->drawRecording(recording);
+        }
+
+        if (recording.m_impl != nullptr)
+        {
+            recording.m_impl->draw();
+        }
+    }
+} // namespace processing
+
+namespace processing
+{
+    void submitCommands(CommandEncoder encoder)
+    {
+        // Submitted on the main thread once the frame runs, so it lands in the frame it was recorded for.
+        if (CommandEncoder* frameEncoder = s_frameEncoder)
+        {
+            return frameEncoder->submitCommands(std::move(encoder));
+        }
+
+        const std::lock_guard lock(s_graphics->encoderMutex);
+        s_graphics->submittedEncoders.push_back(std::move(encoder));
+    }
+} // namespace processing
+
 namespace processing
 {
     void pushRenderbuffer(const Renderbuffer& renderbufferId)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->pushRenderbuffer(renderbufferId);
+        }
+
+        ++s_graphics->frameCounters.renderbufferPushes;
+
         // Flush the rendering state
+        submit_queued_draws();
         s_graphics->renderer->endDraw();
         s_graphics->assetIds.push(renderbufferId.getAssetId().value);
         // s_graphics->renderbufferIds.push(renderbufferId.getAssetId().value);
@@ -298,21 +697,27 @@ namespace processing
         // Activate the new render buffer
         {
             peekDepth() = MIN_DEPTH;
-            s_graphics->renderer->beginDraw(peekFramebuffer());
+            s_graphics->renderer->beginDraw(peekFramebuffer(), peekAssetId());
         }
     }
 
     void popRenderbuffer()
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->popRenderbuffer();
+        }
+
         warnMemoryLeaks();
 
         // Flush the rendering state & pop the current renderbuffer from the stack.
+        submit_queued_draws();
         s_graphics->renderer->endDraw();
         s_graphics->assetIds.pop();
 
         // Reactivate Graphicsrenderbuffer below the recently popped one.
         {
-            s_graphics->renderer->beginDraw(peekFramebuffer());
+            s_graphics->renderer->beginDraw(peekFramebuffer(), peekAssetId());
         }
     }
 
@@ -330,6 +735,11 @@ namespace processing
 
     void pushStyle(const bool extendPreviousStyle)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->pushStyle(extendPreviousStyle);
+        }
+
         if (extendPreviousStyle)
         {
             peekRenderStyles().push(peekStyle());
@@ -342,6 +752,11 @@ namespace processing
 
     void popStyle()
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->popStyle();
+        }
+
         peekRenderStyles().pop();
     }
 
@@ -352,6 +767,11 @@ namespace processing
 
     void pushMatrix(const bool extendPreviousMatrix)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->pushMatrix(extendPreviousMatrix);
+        }
+
         if (extendPreviousMatrix)
         {
             peekMetrics().push(peekMatrix());
@@ -364,16 +784,31 @@ namespace processing
 
     void popMatrix()
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->popMatrix();
+        }
+
         peekMetrics().pop();
     }
 
     void resetMatrix()
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->resetMatrix();
+        }
+
         peekMatrix() = matrix4x4::identity;
     }
 
     void resetMatrix(const matrix4x4& matrix)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->resetMatrix(matrix);
+        }
+
         peekMatrix() = matrix;
     }
 
@@ -384,56 +819,111 @@ namespace processing
 
     void translate(const f32 x, const f32 y)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->translate(x, y);
+        }
+
         resetMatrix(matrix4x4::translation(x, y).combined(peekMatrix()));
     }
 
     void scale(const f32 x, const f32 y)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->scale(x, y);
+        }
+
         resetMatrix(matrix4x4::scaling(x, y).combined(peekMatrix()));
     }
 
     void rotate(const f32 angle)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->rotate(angle);
+        }
+
         resetMatrix(matrix4x4::rotation(angle).combined(peekMatrix()));
     }
 
     void blendMode(const BlendMode mode)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->blendMode(mode);
+        }
+
         peekStyle().blendMode = mode;
     }
 
     void angleMode(const AngleMode mode)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->angleMode(mode);
+        }
+
         peekStyle().angleMode = mode;
     }
 
     void rectMode(const RectMode mode)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->rectMode(mode);
+        }
+
         peekStyle().rectMode = mode;
     }
 
     void ellipseMode(const EllipseMode mode)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->ellipseMode(mode);
+        }
+
         peekStyle().ellipseMode = mode;
     }
 
     void imageMode(const RectMode mode)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->imageMode(mode);
+        }
+
         peekStyle().imageMode = mode;
     }
 
     void imageSourceMode(ImageSourceMode mode)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->imageSourceMode(mode);
+        }
+
         peekStyle().imageSourceMode = mode;
     }
 
     void shader(const Shader& shader)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->shader(shader);
+        }
+
         peekStyle().shader = shader;
     }
 
     void noShader()
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->noShader();
+        }
+
         peekStyle().shader.reset();
     }
 
@@ -449,6 +939,11 @@ namespace processing
 
     void fill(const Color color)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->fill(color);
+        }
+
         RenderStyle& style = peekStyle();
         style.fillColor = color;
         style.isFillEnabled = true;
@@ -456,6 +951,11 @@ namespace processing
 
     void noFill()
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->noFill();
+        }
+
         peekStyle().isFillEnabled = false;
     }
 
@@ -471,6 +971,11 @@ namespace processing
 
     void stroke(const Color color)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->stroke(color);
+        }
+
         RenderStyle& style = peekStyle();
         style.strokeColor = color;
         style.isStrokeEnabled = true;
@@ -478,21 +983,41 @@ namespace processing
 
     void noStroke()
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->noStroke();
+        }
+
         peekStyle().isStrokeEnabled = false;
     }
 
     void strokeWeight(const f32 strokeWeight)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->strokeWeight(strokeWeight);
+        }
+
         peekStyle().strokeWeight = strokeWeight;
     }
 
     void strokeCap(const StrokeCap strokeCap)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->strokeCap(strokeCap);
+        }
+
         peekStyle().strokeCap = strokeCap;
     }
 
     void strokeJoin(const StrokeJoin strokeJoin)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->strokeJoin(strokeJoin);
+        }
+
         peekStyle().strokeJoin = strokeJoin;
     }
 
@@ -508,6 +1033,11 @@ namespace processing
 
     void tint(const Color color)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->tint(color);
+        }
+
         peekStyle().tintColor = color;
     }
 
@@ -523,21 +1053,30 @@ namespace processing
 
     void background(Color color)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->background(color);
+        }
+
         const float2 size = float2{peekFramebuffer().getSize()};
 
         const RenderStyle& style = peekStyle();
         const RectPath path = path_rect(rect2f{0.0f, 0.0f, size.x, size.y});
-        const Contour contour = contour_rect_fill(path);
+        const Contour contour = tessellate_timed([&] { return contour_rect_fill(path); });
         const Vertices vertices = vertices_from_contour(contour, matrix4x4::identity, color, getNextDepth());
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
+        submit_queued_draws();
+        s_graphics->renderer->clear();
         s_graphics->renderer->render(vertices, getRenderState());
     }
 
     void beginShape(const ShapeMode mode)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->beginShape(mode);
+        }
+
         s_graphics->points.clear();
         s_graphics->curvePoints.clear();
         s_graphics->shapeMode = mode;
@@ -546,6 +1085,11 @@ namespace processing
 
     void endShape(const bool closed)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->endShape(closed);
+        }
+
         if (not s_graphics->shapeStarted) return;
         s_graphics->shapeStarted = false;
 
@@ -577,6 +1121,11 @@ namespace processing
 
     void vertex(f32 x, f32 y, f32 u, f32 v)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->vertex(x, y, u, v);
+        }
+
         if (not s_graphics->shapeStarted) return;
 
         const RenderStyle& style = peekStyle();
@@ -593,6 +1142,11 @@ namespace processing
 
     void bezierVertex(f32 x2, f32 y2, f32 x3, f32 y3, f32 x4, f32 y4)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->bezierVertex(x2, y2, x3, y3, x4, y4);
+        }
+
         if (!s_graphics->shapeStarted || s_graphics->points.empty()) return;
 
         // Letzter Punkt ist der Start der Bezier-Kurve
@@ -622,6 +1176,11 @@ namespace processing
 
     void quadraticVertex(f32 cx, f32 cy, f32 x3, f32 y3)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->quadraticVertex(cx, cy, x3, y3);
+        }
+
         if (!s_graphics->shapeStarted || s_graphics->points.empty()) return;
 
         // Letzter Punkt ist der Start
@@ -648,6 +1207,11 @@ namespace processing
 
     void curveVertex(f32 x, f32 y)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->curveVertex(x, y);
+        }
+
         if (!s_graphics->shapeStarted) return;
 
         // Sammle Punkte für Catmull-Rom Spline
@@ -688,23 +1252,27 @@ namespace processing
 
     void rect(f32 x1, f32 y1, f32 x2, f32 y2)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->rect(x1, y1, x2, y2);
+        }
+
+        ++s_graphics->frameCounters.primitives.rects;
+
         const RenderStyle& style = peekStyle();
         const matrix4x4& matrix = peekMatrix();
         const rect2f boundary = convert_to_rect(style.rectMode, x1, y1, x2, y2);
-        const RectPath path = path_rect(boundary);
 
         if (style.isFillEnabled)
         {
-            const Contour contour = contour_rect_fill(path);
-            const Vertices vertices = vertices_from_contour(contour, matrix, style.fillColor, getNextDepth());
-            s_graphics->renderer->render(vertices, getRenderState());
+            const Instance instance = instance_from_rect(boundary, matrix, rect2f{0.0f, 0.0f, 1.0f, 1.0f}, style.fillColor, getNextDepth());
+            render_instance(InstanceShape::quad, instance, getRenderState());
         }
 
         if (style.isStrokeEnabled)
         {
-            const Contour contour = contour_rect_stroke(path, get_stroke_properties(style));
-            const Vertices vertices = vertices_from_contour(contour, matrix, style.strokeColor, getNextDepth());
-            s_graphics->renderer->render(vertices, getRenderState());
+            const StrokeProperties properties = get_stroke_properties(style);
+            render_tessellated([=] { return contour_rect_stroke(path_rect(boundary), properties); }, matrix, style.strokeColor, getNextDepth());
         }
     }
 
@@ -715,30 +1283,36 @@ namespace processing
 
     void ellipse(f32 x1, f32 y1, f32 x2, f32 y2)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->ellipse(x1, y1, x2, y2);
+        }
+
+        ++s_graphics->frameCounters.primitives.ellipses;
+
         const RenderStyle& style = peekStyle();
         const matrix4x4& matrix = peekMatrix();
         const rect2f boundary = ellipse_to_rect(style.ellipseMode, x1, y1, x2, y2);
-        const EllipsePath path = path_ellipse({
-            .center = boundary.center(),
-            .radius = Radius{
-                .x = boundary.width * 0.5f,
-                .y = boundary.height * 0.5f,
-            },
-            .segments = 32,
-        });
 
         if (style.isFillEnabled)
         {
-            const Contour contour = contour_ellipse_fill(path);
-            const Vertices vertices = vertices_from_contour(contour, matrix, style.fillColor, getNextDepth());
-            s_graphics->renderer->render(vertices, getRenderState());
+            const Instance instance = instance_from_rect(boundary, matrix, rect2f{0.0f, 0.0f, 1.0f, 1.0f}, style.fillColor, getNextDepth());
+            render_instance(InstanceShape::circle, instance, getRenderState());
         }
 
         if (style.isStrokeEnabled)
         {
-            const Contour contour = contour_ellipse_stroke(path, get_stroke_properties(style));
-            const Vertices vertices = vertices_from_contour(contour, matrix, style.strokeColor, getNextDepth());
-            s_graphics->renderer->render(vertices, getRenderState());
+            const EllipseSpecification specification = {
+                .center = boundary.center(),
+                .radius = Radius{
+                    .x = boundary.width * 0.5f,
+                    .y = boundary.height * 0.5f,
+                },
+                .segments = 32,
+            };
+
+            const StrokeProperties properties = get_stroke_properties(style);
+            render_tessellated([=] { return contour_ellipse_stroke(path_ellipse(specification), properties); }, matrix, style.strokeColor, getNextDepth());
         }
     }
 
@@ -749,6 +1323,13 @@ namespace processing
 
     void triangle(f32 x1, f32 y1, f32 x2, f32 y2, f32 x3, f32 y3)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->triangle(x1, y1, x2, y2, x3, y3);
+        }
+
+        ++s_graphics->frameCounters.primitives.triangles;
+
         const RenderStyle& style = peekStyle();
         const matrix4x4& matrix = peekMatrix();
         const rect2f boundary = ellipse_to_rect(style.ellipseMode, x1, y1, x2, y2);
@@ -760,47 +1341,50 @@ namespace processing
 
         if (style.isFillEnabled)
         {
-            const Contour contour = contour_triangle_fill(path);
-            const Vertices vertices = vertices_from_contour(contour, matrix, style.fillColor, getNextDepth());
-            s_graphics->renderer->render(vertices, getRenderState());
+            const Contour contour = tessellate_timed([&] { return contour_triangle_fill(path); });
+            render_contour(contour, matrix, style.fillColor, getNextDepth());
         }
 
         if (style.isStrokeEnabled)
         {
-            const Contour contour = contour_triangle_stroke(path, get_stroke_properties(style));
-            const Vertices vertices = vertices_from_contour(contour, matrix, style.strokeColor, getNextDepth());
-            s_graphics->renderer->render(vertices, getRenderState());
+            const StrokeProperties properties = get_stroke_properties(style);
+            render_tessellated([=] { return contour_triangle_stroke(path, properties); }, matrix, style.strokeColor, getNextDepth());
         }
     }
 
     void point(f32 x, f32 y)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->point(x, y);
+        }
+
+        ++s_graphics->frameCounters.primitives.points;
+
         const RenderStyle& style = peekStyle();
         const matrix4x4& matrix = peekMatrix();
         const rect2f boundary = ellipse_to_rect(EllipseMode::centerDiameter, x, y, style.strokeWeight, style.strokeWeight);
-        const EllipsePath path = path_ellipse({
-            .center = boundary.center(),
-            .radius = Radius{
-                .x = boundary.width * 0.5f,
-                .y = boundary.height * 0.5f,
-            },
-            .segments = 32,
-        });
 
-        const Contour contour = contour_ellipse_fill(path);
-        const Vertices vertices = vertices_from_contour(contour, matrix, style.strokeColor, getNextDepth());
-        s_graphics->renderer->render(vertices, getRenderState());
+        const Instance instance = instance_from_rect(boundary, matrix, rect2f{0.0f, 0.0f, 1.0f, 1.0f}, style.strokeColor, getNextDepth());
+        render_instance(InstanceShape::circle, instance, getRenderState());
     }
 
     void line(f32 x1, f32 y1, f32 x2, f32 y2)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->line(x1, y1, x2, y2);
+        }
+
+        ++s_graphics->frameCounters.primitives.lines;
+
         const RenderStyle& style = peekStyle();
         const matrix4x4& matrix = peekMatrix();
         const rect2f boundary = ellipse_to_rect(style.ellipseMode, x1, y1, x2, y2);
 
-        const Contour contour = contour_line(x1, y1, x2, y2, style.strokeWeight, style.strokeCap);
-        const Vertices vertices = vertices_from_contour(contour, matrix, style.strokeColor, getNextDepth());
-        s_graphics->renderer->render(vertices, getRenderState());
+        const f32 strokeWeight = style.strokeWeight;
+        const StrokeCap strokeCap = style.strokeCap;
+        render_tessellated([=] { return contour_line(x1, y1, x2, y2, strokeWeight, strokeCap); }, matrix, style.strokeColor, getNextDepth());
     }
 
     void image(const Image& img, f32 x1, f32 y1)
@@ -811,25 +1395,39 @@ namespace processing
 
     void image(const Image& img, f32 x1, f32 y1, f32 x2, f32 y2)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->image(img, x1, y1, x2, y2);
+        }
+
+        ++s_graphics->frameCounters.primitives.images;
+
         const RenderStyle& style = peekStyle();
         const matrix4x4& matrix = peekMatrix();
         const rect2f boundary = convert_to_rect(style.imageMode, x1, y1, x2, y2);
 
-        const Contour contour = contour_image(boundary.left, boundary.top, boundary.width, boundary.height, 0.0f, 0.0f, 1.0f, 1.0f);
-        const Vertices vertices = vertices_from_contour(contour, matrix, style.tintColor, getNextDepth());
-        s_graphics->renderer->render(vertices, getRenderState(img));
+        const rect2f source = img.getTextureRegion();
+
+        const Instance instance = instance_from_rect(boundary, matrix, flip_source_rect(source), style.tintColor, getNextDepth());
+        render_instance(InstanceShape::quad, instance, getRenderState(img));
     }
 
     void image(const Image& img, f32 x1, f32 y1, f32 x2, f32 y2, f32 sx1, f32 sy1, f32 sx2, f32 sy2)
     {
+        if (CommandEncoder* encoder = s_frameEncoder)
+        {
+            return encoder->image(img, x1, y1, x2, y2, sx1, sy1, sx2, sy2);
+        }
+
+        ++s_graphics->frameCounters.primitives.images;
+
         const auto [imgWidth, imgHeight] = img.getSize();
         const RenderStyle& style = peekStyle();
         const matrix4x4& matrix = peekMatrix();
         const rect2f boundary = convert_to_rect(style.imageMode, x1, y1, x2, y2);
-        const rect2f source = image_source_to_rect(style.imageSourceMode, static_cast<f32>(imgWidth), static_cast<f32>(imgHeight), sx1, sy1, sx2, sy2);
+        const rect2f source = remap_to_region(image_source_to_rect(style.imageSourceMode, static_cast<f32>(imgWidth), static_cast<f32>(imgHeight), sx1, sy1, sx2, sy2), img.getTextureRegion());
 
-        const Contour contour = contour_image(boundary.left, boundary.top, boundary.width, boundary.height, source.left, source.top, source.width, source.height);
-        const Vertices vertices = vertices_from_contour(contour, matrix, style.tintColor, getNextDepth());
-        s_graphics->renderer->render(vertices, getRenderState(img));
+        const Instance instance = instance_from_rect(boundary, matrix, flip_source_rect(source), style.tintColor, getNextDepth());
+        render_instance(InstanceShape::quad, instance, getRenderState(img));
     }
 } // namespace processing
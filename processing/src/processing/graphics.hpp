@@ -30,6 +30,15 @@ namespace processing
     void initGraphics(u32 width, u32 height);
     void beginDraw();
     void endDraw(u32 width, u32 height);
+    // Finishes the frame without blitting the root framebuffer, for contexts that have no window surface.
+    void endDraw();
+    void flushPendingDraws();
+
+    // Redirects the drawing functions called on this thread into the encoder until endFrameEncoding().
+    void beginFrameEncoding(CommandEncoder& encoder);
+    void endFrameEncoding();
+    // The encoder of the pipelined frame recorded on this thread, null outside of it.
+    CommandEncoder* getFrameEncoder();
 } // namespace processing
 
 #endif // _PROCESSING_INCLUDE_GRAPHICS_HPP_
@@ -1,27 +1,49 @@
 #include <processing/image.hpp>
+#include <processing/graphics.hpp>
+#include <processing/pixel_kernels.hpp>
+#include <processing/pixel_readback.hpp>
+#include <processing/state_cache.hpp>
 
 #include <glad/gl.h>
 #include <stb/stb_image.h>
 
+#include <algorithm>
+#include <cstring>
+#include <span>
+
 namespace processing
 {
-    Pixels::Pixels(u32 width, u32 height, PlatformImage* parent, const std::vector<u8>& data)
+    inline static constexpr u32 getTileCount(const u32 size)
+    {
+        return (size + Pixels::DIRTY_TILE_SIZE - 1) / Pixels::DIRTY_TILE_SIZE;
+    }
+
+    Pixels::Pixels(u32 width, u32 height, PlatformImage* parent, std::vector<u32> data)
         : m_width{width},
           m_height{height},
           m_parent{parent},
-          m_data{data}
+          m_data{std::move(data)},
+          m_tileColumns{getTileCount(width)},
+          m_dirtyTiles(static_cast<usize>(getTileCount(width)) * getTileCount(height), false)
     {
     }
 
+    u32 Pixels::pack(const Color color)
+    {
+        return static_cast<u32>(color.r) | static_cast<u32>(color.g) << 8 | static_cast<u32>(color.b) << 16 | static_cast<u32>(color.a) << 24;
+    }
+
+    Color Pixels::unpack(const u32 pixel)
+    {
+        return Color(pixel & 0xFF, (pixel >> 8) & 0xFF, (pixel >> 16) & 0xFF, pixel >> 24);
+    }
+
     void Pixels::set(const u32 x, const u32 y, const Color color)
     {
         if (x < m_width and y < m_height)
         {
-            const usize index = (y * m_width + x) * 4;
-            m_data[index + 0] = color.r;
-            m_data[index + 1] = color.g;
-            m_data[index + 2] = color.b;
-            m_data[index + 3] = color.a;
+            m_data[static_cast<usize>(y) * m_width + x] = pack(color);
+            markDirty(x, y);
         }
     }
 
@@ -29,23 +51,302 @@ namespace processing
     {
         if (x < m_width and y < m_height)
         {
-            const usize index = (y * m_width + x) * 4;
-            return Color(m_data[index + 0], m_data[index + 1], m_data[index + 2], m_data[index + 3]);
+            return unpack(m_data[static_cast<usize>(y) * m_width + x]);
         }
 
         return Color(0);
     }
 
+    u32 Pixels::getWidth() const
+    {
+        return m_width;
+    }
+
+    u32 Pixels::getHeight() const
+    {
+        return m_height;
+    }
+
+    std::span<u32> Pixels::row(const u32 y)
+    {
+        markDirty(rect2u{0, y, m_width, 1});
+        return std::span<u32>(m_data).subspan(static_cast<usize>(y) * m_width, m_width);
+    }
+
+    std::span<const u32> Pixels::row(const u32 y) const
+    {
+        return std::span<const u32>(m_data).subspan(static_cast<usize>(y) * m_width, m_width);
+    }
+
+    PixelView<u32> Pixels::view()
+    {
+        return view(rect2u{0, 0, m_width, m_height});
+    }
+
+    PixelView<u32> Pixels::view(const rect2u& region)
+    {
+        const rect2u clipped = clip(region);
+        markDirty(clipped);
+        return PixelView<u32>{.data = m_data.data() + static_cast<usize>(clipped.top) * m_width + clipped.left, .width = clipped.width, .height = clipped.height, .stride = m_width};
+    }
+
+    PixelView<const u32> Pixels::view() const
+    {
+        return view(rect2u{0, 0, m_width, m_height});
+    }
+
+    PixelView<const u32> Pixels::view(const rect2u& region) const
+    {
+        const rect2u clipped = clip(region);
+        return PixelView<const u32>{.data = m_data.data() + static_cast<usize>(clipped.top) * m_width + clipped.left, .width = clipped.width, .height = clipped.height, .stride = m_width};
+    }
+
+    void Pixels::fill(const Color color)
+    {
+        fill(rect2u{0, 0, m_width, m_height}, color);
+    }
+
+    void Pixels::fill(const rect2u& region, const Color color)
+    {
+        const PixelView<u32> pixels = view(region);
+        const u32 pixel = pack(color);
+        const PixelKernels& kernels = getPixelKernels();
+
+        for (u32 y = 0; y < pixels.height; ++y)
+        {
+            kernels.fill(pixels.row(y).data(), pixels.width, pixel);
+        }
+    }
+
+    void Pixels::copyRect(const rect2u& source, const u32 x, const u32 y)
+    {
+        const rect2u clippedSource = clip(source);
+        if (x >= m_width or y >= m_height)
+        {
+            return;
+        }
+
+        const u32 width = std::min(clippedSource.width, m_width - x);
+        const u32 height = std::min(clippedSource.height, m_height - y);
+        markDirty(rect2u{x, y, width, height});
+
+        // Rows are copied bottom up when the target lies below the source, so no row is overwritten before it is read.
+        const bool isTargetBelow = y > clippedSource.top;
+        for (u32 i = 0; i < height; ++i)
+        {
+            const u32 row = isTargetBelow ? height - 1 - i : i;
+            const u32* from = &m_data[static_cast<usize>(clippedSource.top + row) * m_width + clippedSource.left];
+            u32* to = &m_data[static_cast<usize>(y + row) * m_width + x];
+            std::memmove(to, from, static_cast<usize>(width) * sizeof(u32));
+        }
+    }
+
+    void Pixels::blit(const Pixels& source, const rect2u& sourceRegion, const u32 x, const u32 y)
+    {
+        if (x >= m_width or y >= m_height)
+        {
+            return;
+        }
+
+        const PixelView<const u32> from = source.view(sourceRegion);
+        const PixelView<u32> to = view(rect2u{x, y, from.width, from.height});
+
+        for (u32 row = 0; row < to.height; ++row)
+        {
+            std::ranges::copy(from.row(row).first(to.width), to.row(row).begin());
+        }
+    }
+
+    void Pixels::blend(const Pixels& source, const rect2u& sourceRegion, const u32 x, const u32 y, const BlendMode mode)
+    {
+        if (x >= m_width or y >= m_height)
+        {
+            return;
+        }
+
+        const PixelView<const u32> from = source.view(sourceRegion);
+        const PixelView<u32> to = view(rect2u{x, y, from.width, from.height});
+        const PixelKernels& kernels = getPixelKernels();
+
+        for (u32 row = 0; row < to.height; ++row)
+        {
+            kernels.blend(to.row(row).data(), from.row(row).data(), to.width, mode);
+        }
+    }
+
+    void Pixels::tint(const Color color)
+    {
+        markDirty(rect2u{0, 0, m_width, m_height});
+        getPixelKernels().tint(m_data.data(), m_data.size(), pack(color));
+    }
+
+    void Pixels::premultiply()
+    {
+        markDirty(rect2u{0, 0, m_width, m_height});
+        getPixelKernels().premultiply(m_data.data(), m_data.size());
+    }
+
+    void Pixels::unpremultiply()
+    {
+        markDirty(rect2u{0, 0, m_width, m_height});
+        getPixelKernels().unpremultiply(m_data.data(), m_data.size());
+    }
+
+    void Pixels::grayscale()
+    {
+        markDirty(rect2u{0, 0, m_width, m_height});
+        getPixelKernels().grayscale(m_data.data(), m_data.size());
+    }
+
+    void Pixels::invert()
+    {
+        markDirty(rect2u{0, 0, m_width, m_height});
+        getPixelKernels().invert(m_data.data(), m_data.size());
+    }
+
+    void Pixels::threshold(const u8 level)
+    {
+        markDirty(rect2u{0, 0, m_width, m_height});
+        getPixelKernels().threshold(m_data.data(), m_data.size(), level);
+    }
+
+    void Pixels::markDirty(const rect2u& region)
+    {
+        const rect2u clipped = clip(region);
+        if (clipped.width == 0 or clipped.height == 0)
+        {
+            return;
+        }
+
+        for (u32 tileY = clipped.top / DIRTY_TILE_SIZE; tileY <= (clipped.bottom() - 1) / DIRTY_TILE_SIZE; ++tileY)
+        {
+            for (u32 tileX = clipped.left / DIRTY_TILE_SIZE; tileX <= (clipped.right() - 1) / DIRTY_TILE_SIZE; ++tileX)
+            {
+                m_dirtyTiles[tileY * m_tileColumns + tileX] = true;
+            }
+        }
+    }
+
     void Pixels::commit()
     {
-        glBindTexture(GL_TEXTURE_2D, m_parent->getResourceId().value);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, m_data.data());
+        // The tiles stay dirty, so a commit outside of the pipelined frame still uploads them.
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Pixels cannot be committed while a pipelined frame is recorded");
+            fflush(stdout);
+            return;
+        }
+
+        // Dirty tiles next to each other in a tile row are uploaded together, rows with the same
+        // runs as the row above extend its uploads downwards.
+        std::vector<rect2u> regions;
+        usize previousRowBegin = 0;
+
+        for (u32 tileY = 0; tileY * DIRTY_TILE_SIZE < m_height; ++tileY)
+        {
+            const usize rowBegin = regions.size();
+            const u32 top = tileY * DIRTY_TILE_SIZE;
+            const u32 height = std::min(DIRTY_TILE_SIZE, m_height - top);
+
+            for (u32 tileX = 0; tileX < m_tileColumns;)
+            {
+                if (not m_dirtyTiles[tileY * m_tileColumns + tileX])
+                {
+                    ++tileX;
+                    continue;
+                }
+
+                const u32 firstTileX = tileX;
+                while (tileX < m_tileColumns and m_dirtyTiles[tileY * m_tileColumns + tileX])
+                {
+                    ++tileX;
+                }
+
+                const u32 left = firstTileX * DIRTY_TILE_SIZE;
+                regions.push_back(rect2u{left, top, std::min(tileX * DIRTY_TILE_SIZE, m_width) - left, height});
+            }
+
+            const bool continuesPreviousRow =
+                rowBegin > previousRowBegin and
+                regions.size() - rowBegin == rowBegin - previousRowBegin and
+                std::ranges::equal(
+                    std::span(regions).subspan(previousRowBegin, rowBegin - previousRowBegin),
+                    std::span(regions).subspan(rowBegin),
+                    [](const rect2u& above, const rect2u& below) { return above.left == below.left and above.width == below.width and above.bottom() == below.top; }
+                );
+
+            if (continuesPreviousRow)
+            {
+                for (usize i = previousRowBegin; i < rowBegin; ++i)
+                {
+                    regions[i].height += height;
+                }
+
+                regions.resize(rowBegin);
+            }
+            else
+            {
+                previousRowBegin = rowBegin;
+            }
+        }
+
+        if (regions.empty())
+        {
+            return;
+        }
+
+        // Batched draws that still sample the old contents have to reach the GPU first.
+        flushPendingDraws();
+
+        for (const rect2u& region : regions)
+        {
+            m_parent->updatePixels(region, m_width, reinterpret_cast<const u8*>(&m_data[static_cast<usize>(region.top) * m_width + region.left]));
+        }
+
+        std::fill(m_dirtyTiles.begin(), m_dirtyTiles.end(), false);
+    }
+
+    void Pixels::markDirty(const u32 x, const u32 y)
+    {
+        m_dirtyTiles[(y / DIRTY_TILE_SIZE) * m_tileColumns + x / DIRTY_TILE_SIZE] = true;
+    }
+
+    rect2u Pixels::clip(const rect2u& region) const
+    {
+        if (region.left >= m_width or region.top >= m_height)
+        {
+            return rect2u{0, 0, 0, 0};
+        }
+
+        return rect2u{region.left, region.top, std::min(region.width, m_width - region.left), std::min(region.height, m_height - region.top)};
     }
 } // namespace processing
 
 namespace processing
 {
+    inline static bool hasOpaqueAlpha(const u32 width, const u32 height, const u32 rowLength, const u8* data)
+    {
+        for (u32 y = 0; y < height; ++y)
+        {
+            for (u32 x = 0; x < width; ++x)
+            {
+                if (data[(static_cast<usize>(y) * rowLength + x) * 4 + 3] != 255)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Pixels outside the updated region keep whatever opacity they had before.
+    inline static bool isOpaqueAfterUpdate(const bool wasOpaque, const uint2& size, const rect2u& region, const u32 rowLength, const u8* data)
+    {
+        const bool coversImage = region.left == 0 and region.top == 0 and region.width == size.x and region.height == size.y;
+        return (wasOpaque or coversImage) and hasOpaqueAlpha(region.width, region.height, rowLength, data);
+    }
+
     class OpenGLPlatformImage : public PlatformImage
     {
     private:
@@ -78,51 +379,30 @@ namespace processing
         {
             ResourceId resourceId = {.value = 0};
             glGenTextures(1, &resourceId.value);
-            glBindTexture(GL_TEXTURE_2D, resourceId.value);
+            getStateCache().bindTexture(0, resourceId);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterModeToGLId(filterMode.mag));
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterModeToGLId(filterMode.min));
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, extendModeToGLId(extendMode.horizontal));
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, extendModeToGLId(extendMode.vertical));
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            glBindTexture(GL_TEXTURE_2D, 0);
-
-            return std::unique_ptr<OpenGLPlatformImage>(new OpenGLPlatformImage(uint2{width, height}, resourceId, filterMode, extendMode));
-        }
-
-        static std::unique_ptr<OpenGLPlatformImage> load(const std::filesystem::path& filepath, FilterMode filterMode, ExtendMode extendMode)
-        {
-            stbi_set_flip_vertically_on_load(1);
-
-            int width, height;
-            std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> data(stbi_load(filepath.string().c_str(), &width, &height, nullptr, STBI_rgb_alpha), &stbi_image_free);
-            if (data == nullptr)
-            {
-                return nullptr;
-            }
-
-            ResourceId resourceId = {.value = 0};
-            glGenTextures(1, &resourceId.value);
-            glBindTexture(GL_TEXTURE_2D, resourceId.value);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterModeToGLId(filterMode.mag));
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterModeToGLId(filterMode.min));
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, extendModeToGLId(extendMode.horizontal));
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, extendModeToGLId(extendMode.vertical));
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.get());
-            glBindTexture(GL_TEXTURE_2D, 0);
 
-            return std::unique_ptr<OpenGLPlatformImage>(new OpenGLPlatformImage(uint2{static_cast<u32>(width), static_cast<u32>(height)}, resourceId, filterMode, extendMode));
+            // Contents rendered on the GPU are unknown, so images without initial data never count as opaque.
+            const bool isOpaque = data != nullptr and hasOpaqueAlpha(width, height, width, data);
+            return std::unique_ptr<OpenGLPlatformImage>(new OpenGLPlatformImage(uint2{width, height}, resourceId, filterMode, extendMode, isOpaque));
         }
 
         ~OpenGLPlatformImage() override
         {
             glDeleteTextures(1, &m_resourceId.value);
+            getStateCache().invalidateTexture(m_resourceId);
         }
 
         void setFilterMode(FilterMode mode) override
         {
             if (m_filterMode != mode)
             {
-                glBindTexture(GL_TEXTURE_2D, m_resourceId.value);
+                flushPendingDraws();
+                getStateCache().bindTexture(0, m_resourceId);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterModeToGLId(mode.mag));
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterModeToGLId(mode.min));
                 m_filterMode = mode;
@@ -138,7 +418,8 @@ namespace processing
         {
             if (m_extendMode != mode)
             {
-                glBindTexture(GL_TEXTURE_2D, m_resourceId.value);
+                flushPendingDraws();
+                getStateCache().bindTexture(0, m_resourceId);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, extendModeToGLId(mode.horizontal));
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, extendModeToGLId(mode.vertical));
                 m_extendMode = mode;
@@ -157,11 +438,29 @@ namespace processing
 
         Pixels loadPixels() override
         {
-            std::vector<u8> data(m_size.x * m_size.y * 4);
-            glBindTexture(GL_TEXTURE_2D, m_resourceId.value);
+            flushPendingDraws();
+
+            std::vector<u32> data(static_cast<usize>(m_size.x) * m_size.y);
+            getStateCache().bindTexture(0, m_resourceId);
             glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
 
-            return Pixels(m_size.x, m_size.y, this, data);
+            return Pixels(m_size.x, m_size.y, this, std::move(data));
+        }
+
+        PixelsRequest loadPixelsAsync() override
+        {
+            return PixelsRequest(PendingPixels::create(this, m_resourceId, rect2u{0, 0, m_size.x, m_size.y}));
+        }
+
+        void updatePixels(const rect2u& region, const u32 rowLength, const u8* data) override
+        {
+            getStateCache().bindTexture(0, m_resourceId);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(rowLength));
+            glTexSubImage2D(GL_TEXTURE_2D, 0, region.left, region.top, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+            m_isOpaque = isOpaqueAfterUpdate(m_isOpaque, m_size, region, rowLength, data);
         }
 
         ResourceId getResourceId() const override
@@ -169,12 +468,23 @@ namespace processing
             return m_resourceId;
         }
 
+        rect2f getTextureRegion() const override
+        {
+            return rect2f{0.0f, 0.0f, 1.0f, 1.0f};
+        }
+
+        bool isOpaque() const override
+        {
+            return m_isOpaque;
+        }
+
     private:
-        explicit OpenGLPlatformImage(const uint2& size, ResourceId resourceId, FilterMode filterMode, ExtendMode extendMode)
+        explicit OpenGLPlatformImage(const uint2& size, ResourceId resourceId, FilterMode filterMode, ExtendMode extendMode, const bool isOpaque)
             : m_size(size),
               m_resourceId(resourceId),
               m_extendMode(extendMode),
-              m_filterMode(filterMode)
+              m_filterMode(filterMode),
+              m_isOpaque(isOpaque)
         {
         }
 
@@ -182,19 +492,196 @@ namespace processing
         ResourceId m_resourceId;
         FilterMode m_filterMode;
         ExtendMode m_extendMode;
+        bool m_isOpaque;
     };
 } // namespace processing
 
 namespace processing
 {
-    Image ImageAssetHandler::createImage(u32 width, u32 height, const u8* data, FilterMode filterMode, ExtendMode extendMode)
+    // A sub-rectangle of a shared atlas page, surrounded by a one pixel gutter that repeats the
+    // border pixels so linear filtering never samples a neighbour. Changing the filter or extend
+    // mode moves the image out of the atlas into a texture of its own.
+    class AtlasPlatformImage : public PlatformImage
     {
-        if (auto image = OpenGLPlatformImage::create(width, height, data, filterMode, extendMode))
+    public:
+        inline static constexpr u32 GUTTER = 1;
+
+        explicit AtlasPlatformImage(std::shared_ptr<PlatformImage> page, const rect2u& region)
+            : m_page(std::move(page)),
+              m_region(region),
+              m_isDetached(false),
+              m_isOpaque(false)
+        {
+        }
+
+        void setFilterMode(FilterMode mode) override
+        {
+            if (m_isDetached)
+            {
+                m_page->setFilterMode(mode);
+            }
+            else if (m_page->getFilterMode() != mode)
+            {
+                detach(mode, m_page->getExtendMode());
+            }
+        }
+
+        FilterMode getFilterMode() const override
+        {
+            return m_page->getFilterMode();
+        }
+
+        void setExtendMode(ExtendMode mode) override
+        {
+            if (m_isDetached)
+            {
+                m_page->setExtendMode(mode);
+            }
+            else if (mode != ExtendMode::clamp)
+            {
+                detach(m_page->getFilterMode(), mode);
+            }
+        }
+
+        ExtendMode getExtendMode() const override
+        {
+            return m_page->getExtendMode();
+        }
+
+        uint2 getSize() const override
         {
-            std::shared_ptr<PlatformImage>& ptr = m_assets.emplace_back(std::move(image));
-            AssetId assetId = {.value = m_assets.size()};
+            return m_region.size;
+        }
+
+        Pixels loadPixels() override
+        {
+            return Pixels(m_region.width, m_region.height, this, readPixels());
+        }
+
+        PixelsRequest loadPixelsAsync() override
+        {
+            // Only the region is read back, not the whole page.
+            return PixelsRequest(PendingPixels::create(this, m_page->getResourceId(), m_region));
+        }
+
+        void updatePixels(const rect2u& region, const u32 rowLength, const u8* data) override
+        {
+            if (m_isDetached)
+            {
+                m_page->updatePixels(region, rowLength, data);
+                return;
+            }
+
+            m_isOpaque = isOpaqueAfterUpdate(m_isOpaque, m_region.size, region, rowLength, data);
+
+            // Grow the update into the gutter wherever it touches the border of the image.
+            const i64 left = region.left == 0 ? -static_cast<i64>(GUTTER) : region.left;
+            const i64 top = region.top == 0 ? -static_cast<i64>(GUTTER) : region.top;
+            const i64 right = region.right() == m_region.width ? m_region.width + GUTTER : region.right();
+            const i64 bottom = region.bottom() == m_region.height ? m_region.height + GUTTER : region.bottom();
+
+            const u32 width = static_cast<u32>(right - left);
+            const u32 height = static_cast<u32>(bottom - top);
+            std::vector<u8> block(static_cast<usize>(width) * height * 4);
+
+            for (u32 y = 0; y < height; ++y)
+            {
+                const i64 sourceY = std::clamp<i64>(top + y, region.top, region.bottom() - 1) - region.top;
+
+                for (u32 x = 0; x < width; ++x)
+                {
+                    const i64 sourceX = std::clamp<i64>(left + x, region.left, region.right() - 1) - region.left;
+                    std::memcpy(&block[(static_cast<usize>(y) * width + x) * 4], &data[(sourceY * rowLength + sourceX) * 4], 4);
+                }
+            }
+
+            const rect2u pageRegion = {
+                static_cast<u32>(m_region.left + left),
+                static_cast<u32>(m_region.top + top),
+                width,
+                height,
+            };
+
+            m_page->updatePixels(pageRegion, width, block.data());
+        }
+
+        ResourceId getResourceId() const override
+        {
+            return m_page->getResourceId();
+        }
+
+        rect2f getTextureRegion() const override
+        {
+            if (m_isDetached)
+            {
+                return rect2f{0.0f, 0.0f, 1.0f, 1.0f};
+            }
+
+            const float2 pageSize = float2{m_page->getSize()};
+            return rect2f{
+                static_cast<f32>(m_region.left) / pageSize.x,
+                static_cast<f32>(m_region.top) / pageSize.y,
+                static_cast<f32>(m_region.width) / pageSize.x,
+                static_cast<f32>(m_region.height) / pageSize.y,
+            };
+        }
+
+        bool isOpaque() const override
+        {
+            // The page holds other images as well, only a detached texture is entirely ours.
+            return m_isDetached ? m_page->isOpaque() : m_isOpaque;
+        }
+
+    private:
+        // Reads only the region through a framebuffer, not the whole page.
+        std::vector<u32> readPixels() const
+        {
+            flushPendingDraws();
+
+            std::vector<u32> data(static_cast<usize>(m_region.width) * m_region.height);
+            getStateCache().bindReadFramebuffer(getPixelReadbackPool().getFramebufferId());
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_page->getResourceId().value, 0);
+
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(static_cast<GLint>(m_region.left), static_cast<GLint>(m_region.top), static_cast<GLsizei>(m_region.width), static_cast<GLsizei>(m_region.height), GL_RGBA, GL_UNSIGNED_BYTE, data.data());
 
-            return Image(assetId, ptr);
+            // The framebuffer must not keep deleted textures alive.
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+            return data;
+        }
+
+        void detach(FilterMode filterMode, ExtendMode extendMode)
+        {
+            const std::vector<u32> data = readPixels();
+
+            // The vacated rectangle in the page is not reclaimed.
+            m_page = OpenGLPlatformImage::create(m_region.width, m_region.height, reinterpret_cast<const u8*>(data.data()), filterMode, extendMode);
+            m_region = rect2u{0, 0, m_region.width, m_region.height};
+            m_isDetached = true;
+        }
+
+        std::shared_ptr<PlatformImage> m_page;
+        rect2u m_region;
+        bool m_isDetached;
+        bool m_isOpaque;
+    };
+} // namespace processing
+
+namespace processing
+{
+    Image ImageAssetHandler::createImage(u32 width, u32 height, const u8* data, FilterMode filterMode, ExtendMode extendMode, const ImagePlacement placement)
+    {
+        if (placement == ImagePlacement::automatic and isAtlasCandidate(width, height, extendMode))
+        {
+            if (auto image = createAtlasImage(width, height, data, filterMode))
+            {
+                return registerAsset(std::move(image));
+            }
+        }
+
+        if (auto image = OpenGLPlatformImage::create(width, height, data, filterMode, extendMode))
+        {
+            return registerAsset(std::move(image));
         }
 
         return Image(AssetId{.value = 0}, nullptr);
@@ -202,21 +689,95 @@ namespace processing
 
     Image ImageAssetHandler::loadImage(const std::filesystem::path& filepath, FilterMode filterMode, ExtendMode extendMode)
     {
-        if (auto image = OpenGLPlatformImage::load(filepath, filterMode, extendMode))
-        {
-            std::shared_ptr<PlatformImage>& ptr = m_assets.emplace_back(std::move(image));
-            AssetId assetId = {.value = m_assets.size()};
+        const ProfileScope scope("loadImage");
+        stbi_set_flip_vertically_on_load(1);
 
-            return Image(assetId, ptr);
+        int width, height;
+        std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> data(stbi_load(filepath.string().c_str(), &width, &height, nullptr, STBI_rgb_alpha), &stbi_image_free);
+        if (data == nullptr)
+        {
+            return Image(AssetId{.value = 0}, nullptr);
         }
 
-        return Image(AssetId{.value = 0}, nullptr);
+        return createImage(static_cast<u32>(width), static_cast<u32>(height), data.get(), filterMode, extendMode);
     }
 
     Image ImageAssetHandler::loadAsset(AssetId assetId)
     {
         return Image(assetId, m_assets[assetId.value]);
     }
+
+    bool ImageAssetHandler::isAtlasCandidate(const u32 width, const u32 height, const ExtendMode extendMode) const
+    {
+        return isHintEnabled(Hint::textureAtlas) and
+               extendMode == ExtendMode::clamp and
+               width > 0 and width <= ATLAS_MAX_IMAGE_SIZE and
+               height > 0 and height <= ATLAS_MAX_IMAGE_SIZE;
+    }
+
+    std::shared_ptr<PlatformImage> ImageAssetHandler::createAtlasImage(u32 width, u32 height, const u8* data, FilterMode filterMode)
+    {
+        const uint2 paddedSize = uint2{width + 2 * AtlasPlatformImage::GUTTER, height + 2 * AtlasPlatformImage::GUTTER};
+
+        // Pages are shared per filter mode, the extend mode of atlas images is always clamp.
+        auto findSpace = [&](AtlasPage& page) -> std::optional<uint2>
+        {
+            if (page.image->getFilterMode() != filterMode)
+            {
+                return std::nullopt;
+            }
+
+            return page.packer.pack(paddedSize);
+        };
+
+        AtlasPage* target = nullptr;
+        std::optional<uint2> position;
+
+        for (AtlasPage& page : m_atlasPages)
+        {
+            if ((position = findSpace(page)))
+            {
+                target = &page;
+                break;
+            }
+        }
+
+        if (target == nullptr)
+        {
+            const std::vector<u8> blank(static_cast<usize>(ATLAS_PAGE_SIZE) * ATLAS_PAGE_SIZE * 4, 0);
+            std::shared_ptr<PlatformImage> pageImage = OpenGLPlatformImage::create(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, blank.data(), filterMode, ExtendMode::clamp);
+            if (pageImage == nullptr)
+            {
+                return nullptr;
+            }
+
+            target = &m_atlasPages.emplace_back(AtlasPage{.image = std::move(pageImage), .packer = SkylinePacker(uint2{ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE})});
+            position = findSpace(*target);
+
+            if (not position.has_value())
+            {
+                return nullptr;
+            }
+        }
+
+        const rect2u region = {position->x + AtlasPlatformImage::GUTTER, position->y + AtlasPlatformImage::GUTTER, width, height};
+        auto image = std::make_shared<AtlasPlatformImage>(target->image, region);
+
+        if (data != nullptr)
+        {
+            image->updatePixels(rect2u{0, 0, width, height}, width, data);
+        }
+
+        return image;
+    }
+
+    Image ImageAssetHandler::registerAsset(std::shared_ptr<PlatformImage> image)
+    {
+        std::shared_ptr<PlatformImage>& ptr = m_assets.emplace_back(std::move(image));
+        AssetId assetId = {.value = m_assets.size()};
+
+        return Image(assetId, ptr);
+    }
 } // namespace processing
 
 namespace processing
@@ -235,6 +796,13 @@ namespace processing
 
     void Image::setFilterMode(FilterMode mode)
     {
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Filter modes cannot be changed while a pipelined frame is recorded");
+            fflush(stdout);
+            return;
+        }
+
         m_impl->setFilterMode(mode);
     }
 
@@ -245,6 +813,13 @@ namespace processing
 
     void Image::setExtendMode(ExtendMode mode)
     {
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Extend modes cannot be changed while a pipelined frame is recorded");
+            fflush(stdout);
+            return;
+        }
+
         m_impl->setExtendMode(mode);
     }
 
@@ -260,14 +835,43 @@ namespace processing
 
     Pixels Image::loadPixels()
     {
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Pixels cannot be loaded while a pipelined frame is recorded");
+            fflush(stdout);
+            return Pixels(0, 0, nullptr, {});
+        }
+
         return m_impl->loadPixels();
     }
 
+    PixelsRequest Image::loadPixelsAsync()
+    {
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Pixels cannot be loaded while a pipelined frame is recorded");
+            fflush(stdout);
+            return PixelsRequest{};
+        }
+
+        return m_impl->loadPixelsAsync();
+    }
+
     ResourceId Image::getResourceId() const
     {
         return m_impl->getResourceId();
     }
 
+    rect2f Image::getTextureRegion() const
+    {
+        return m_impl->getTextureRegion();
+    }
+
+    bool Image::isOpaque() const
+    {
+        return m_impl->isOpaque();
+    }
+
     AssetId Image::getAssetId() const
     {
         return m_assetId;
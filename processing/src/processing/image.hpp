@@ -2,19 +2,43 @@
 #define _PROCESSING_INCLUDE_IMAGE_HPP_
 
 #include <processing/processing.hpp>
+#include <processing/skyline_packer.hpp>
 
 namespace processing
 {
+    enum class ImagePlacement
+    {
+        automatic,
+        standalone,
+    };
+
     class ImageAssetHandler
     {
     public:
-        Image createImage(u32 width, u32 height, const u8* data, FilterMode filterMode, ExtendMode extendMode);
+        inline static constexpr u32 ATLAS_PAGE_SIZE = 2048;
+        inline static constexpr u32 ATLAS_MAX_IMAGE_SIZE = 256;
+
+        Image createImage(u32 width, u32 height, const u8* data, FilterMode filterMode, ExtendMode extendMode, ImagePlacement placement = ImagePlacement::automatic);
         Image loadImage(const std::filesystem::path& filepath, FilterMode filterMode, ExtendMode extendMode);
         Image loadAsset(AssetId assetId);
 
     private:
+        struct AtlasPage
+        {
+            std::shared_ptr<PlatformImage> image;
+            SkylinePacker packer;
+        };
+
+        bool isAtlasCandidate(u32 width, u32 height, ExtendMode extendMode) const;
+        std::shared_ptr<PlatformImage> createAtlasImage(u32 width, u32 height, const u8* data, FilterMode filterMode);
+        Image registerAsset(std::shared_ptr<PlatformImage> image);
+
+        std::vector<AtlasPage> m_atlasPages;
         std::vector<std::shared_ptr<PlatformImage>> m_assets;
     };
+
+    // Render targets and other images whose texture must not be shared.
+    Image createStandaloneImage(u32 width, u32 height, const u8* data, FilterMode filterMode, ExtendMode extendMode);
 } // namespace processing
 
 #endif // _PROCESSING_INCLUDE_IMAGE_HPP_
@@ -1,70 +1,200 @@
-#include <processing/processing.hpp>
+#include <processing/math.hpp>
+
+#include <algorithm>
 
 namespace processing
 {
+    static Xoshiro256PP s_random;
 
-    class Xoshiro256PP
+    void randomSeed(const u64 seed)
     {
-    private:
-        uint64_t s[4];
+        s_random = Xoshiro256PP{seed};
+    }
 
-        static inline uint64_t rotl(uint64_t x, int k)
-        {
-            return (x << k) | (x >> (64 - k));
-        }
+    f32 random(const f32 max)
+    {
+        return s_random.nextFloat() * max;
+    }
 
-    public:
-        explicit Xoshiro256PP(uint64_t seed = 0x853c49e6748fea9bULL)
-        {
-            s[0] = seed;
-            s[1] = seed * 0x9e3779b97f4a7c15ULL;
-            s[2] = seed * 0xbf58476d1ce4e5b9ULL;
-            s[3] = seed * 0x94d049bb133111ebULL;
-        }
+    f32 random(const f32 min, const f32 max)
+    {
+        return min + s_random.nextFloat() * (max - min);
+    }
+} // namespace processing
 
-        uint64_t next()
-        {
-            uint64_t result = rotl(s[0] + s[3], 23) + s[0];
-            uint64_t t = s[1] << 17;
+namespace processing
+{
+    f32 map(const f32 value, const f32 istart, const f32 istop, const f32 ostart, const f32 ostop)
+    {
+        return ostart + (ostop - ostart) * ((value - istart) / (istop - istart));
+    }
+} // namespace processing
 
-            s[2] ^= s[0];
-            s[3] ^= s[1];
-            s[1] ^= s[2];
-            s[0] ^= s[3];
-            s[2] ^= t;
-            s[3] = rotl(s[3], 45);
+namespace processing
+{
+    matrix4x4::matrix4x4()
+        : data{
+              1.0f, 0.0f, 0.0f, 0.0f,
+              0.0f, 1.0f, 0.0f, 0.0f,
+              0.0f, 0.0f, 1.0f, 0.0f,
+              0.0f, 0.0f, 0.0f, 1.0f
+          }
+    {
+    }
 
-            return result;
-        }
+    matrix4x4::matrix4x4(
+        float m00, float m01, float m02, float m03,
+        float m10, float m11, float m12, float m13,
+        float m20, float m21, float m22, float m23,
+        float m30, float m31, float m32, float m33
+    )
+        : data{
+              m00, m01, m02, m03,
+              m10, m11, m12, m13,
+              m20, m21, m22, m23,
+              m30, m31, m32, m33
+          }
+    {
+    }
 
-        f32 nextFloat()
+    matrix4x4 matrix4x4::combined(const matrix4x4& other) const
+    {
+        matrix4x4 result;
+
+        for (int i = 0; i < 4; ++i)
         {
-            return (next() >> 40) * 0x1.0p-24f;
+            for (int j = 0; j < 4; ++j)
+            {
+                result.data[i * 4 + j] =
+                    data[i * 4 + 0] * other.data[0 * 4 + j] +
+                    data[i * 4 + 1] * other.data[1 * 4 + j] +
+                    data[i * 4 + 2] * other.data[2 * 4 + j] +
+                    data[i * 4 + 3] * other.data[3 * 4 + j];
+            }
         }
-    };
 
-    static Xoshiro256PP s_random;
+        return result;
+    }
 
-    void randomSeed(const u64 seed)
+    matrix4x4 matrix4x4::orthographic(f32 left, f32 top, f32 width, f32 height, f32 near, f32 far)
     {
-        s_random = Xoshiro256PP{seed};
+        f32 right = left + width;
+        f32 bottom = top + height;
+
+        f32 rl = right - left;
+        f32 tb = top - bottom;
+        f32 fn = far - near;
+
+        return matrix4x4{
+            2.0f / rl, 0.0f, 0.0f, 0.0f,
+            0.0f, 2.0f / tb, 0.0f, 0.0f,
+            0.0f, 0.0f, -2.0f / fn, 0.0f,
+            -(right + left) / rl, -(top + bottom) / tb, -(far + near) / fn, 1.0f
+        };
     }
 
-    f32 random(const f32 max)
+    matrix4x4 matrix4x4::translation(const f32 x, const f32 y)
     {
-        return s_random.nextFloat() * max;
+        return matrix4x4{
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            x, y, 0.0f, 1.0f
+        };
     }
 
-    f32 random(const f32 min, const f32 max)
+    matrix4x4 matrix4x4::scaling(const f32 x, const f32 y)
     {
-        return min + s_random.nextFloat() * (max - min);
+        return matrix4x4{
+            x, 0.0f, 0.0f, 0.0f,
+            0.0f, y, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+
+    matrix4x4 matrix4x4::rotation(const f32 angle)
+    {
+        const f32 cos = std::cos(angle);
+        const f32 sin = std::sin(angle);
+
+        return matrix4x4{
+            cos, sin, 0.0f, 0.0f,
+            -sin, cos, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        };
+    }
+
+    float2 matrix4x4::transformPoint(const float2& point) const
+    {
+        // f32 x = data[0] * point.x + data[1] * point.y + data[3];
+        // f32 y = data[4] * point.x + data[5] * point.y + data[7];
+        // f32 w = data[12] * point.x + data[13] * point.y + data[15];
+        //
+        // if (w != 0.0f && w != 1.0f)
+        // {
+        //     return float2(x / w, y / w);
+        // }
+        //
+        // return float2(x, y);
+
+        float x = data[0] * point.x + data[4] * point.y + data[12];
+        float y = data[1] * point.x + data[5] * point.y + data[13];
+        float w = data[3] * point.x + data[7] * point.y + data[15];
+
+        if (w != 0.0f && w != 1.0f)
+        {
+            return float2(x / w, y / w);
+        }
+
+        return float2(x, y);
     }
+
+    float3 matrix4x4::transformPoint(const float3& point) const
+    {
+        float x = data[0] * point.x + data[4] * point.y + data[8] * point.z + data[12];
+        float y = data[1] * point.x + data[5] * point.y + data[9] * point.z + data[13];
+        float z = data[2] * point.x + data[6] * point.y + data[10] * point.z + data[14];
+        float w = data[3] * point.x + data[7] * point.y + data[11] * point.z + data[15];
+
+        if (w != 0.0f && w != 1.0f)
+        {
+            return float3(x / w, y / w, z / w);
+        }
+
+        return float3(x, y, z);
+    }
+
+    const matrix4x4 matrix4x4::identity;
 } // namespace processing
 
 namespace processing
 {
-    f32 map(const f32 value, const f32 istart, const f32 istop, const f32 ostart, const f32 ostop)
+    Color::Color()
+        : Color(255)
     {
-        return ostart + (ostop - ostart) * ((value - istart) / (istop - istart));
+    }
+    Color::Color(const i32 red, const i32 green, const i32 blue, const i32 alpha)
+        : r{static_cast<u8>(std::clamp(red, 0, 255))},
+          g{static_cast<u8>(std::clamp(green, 0, 255))},
+          b{static_cast<u8>(std::clamp(blue, 0, 255))},
+          a{static_cast<u8>(std::clamp(alpha, 0, 255))}
+    {
+    }
+
+    Color::Color(const i32 grey, const i32 alpha)
+        : Color(grey, grey, grey, alpha)
+    {
+    }
+
+    i32 Color::brightness() const
+    {
+        const f32 r = 0.2126f * static_cast<f32>(r);
+        const f32 g = 0.7152f * static_cast<f32>(g);
+        const f32 b = 0.0722f * static_cast<f32>(b);
+        const f32 luminance = r + g + b;
+
+        return static_cast<i32>(luminance);
     }
 } // namespace processing
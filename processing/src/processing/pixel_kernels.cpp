@@ -0,0 +1,252 @@
+#include <processing/pixel_kernels.hpp>
+
+#include <algorithm>
+
+#if defined(_MSC_VER) and (defined(_M_X64) or defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace processing
+{
+    inline static constexpr u32 div255(const u32 value)
+    {
+        const u32 rounded = value + 128;
+        return (rounded + (rounded >> 8)) >> 8;
+    }
+
+    inline static constexpr u32 getChannel(const u32 pixel, const u32 channel)
+    {
+        return (pixel >> (channel * 8)) & 0xFF;
+    }
+
+    inline static constexpr u32 getLuminance(const u32 pixel)
+    {
+        return (54 * getChannel(pixel, 0) + 183 * getChannel(pixel, 1) + 19 * getChannel(pixel, 2) + 128) >> 8;
+    }
+
+    template <BlendMode Mode>
+    inline static u32 blendChannel(const u32 destination, const u32 source, const u32 sourceAlpha, const bool isAlpha)
+    {
+        const u32 inverseSourceAlpha = 255 - sourceAlpha;
+
+        if constexpr (Mode == BlendMode::alpha)
+        {
+            return div255(source * (isAlpha ? 255 : sourceAlpha)) + div255(destination * inverseSourceAlpha);
+        }
+        else if constexpr (Mode == BlendMode::premultiplied)
+        {
+            return source + div255(destination * inverseSourceAlpha);
+        }
+        else if constexpr (Mode == BlendMode::additive)
+        {
+            return div255(source * (isAlpha ? 255 : sourceAlpha)) + destination;
+        }
+        else if constexpr (Mode == BlendMode::multiply)
+        {
+            return isAlpha ? source + div255(destination * inverseSourceAlpha) : div255(source * destination);
+        }
+        else if constexpr (Mode == BlendMode::screen)
+        {
+            return source + div255(destination * (255 - source));
+        }
+        else if constexpr (Mode == BlendMode::subtract)
+        {
+            if (isAlpha)
+            {
+                return source + destination;
+            }
+
+            const u32 subtrahend = div255(source * sourceAlpha);
+            return destination > subtrahend ? destination - subtrahend : 0;
+        }
+        else
+        {
+            return source;
+        }
+    }
+
+    template <BlendMode Mode>
+    inline static void blendScalar(u32* destination, const u32* source, const usize count)
+    {
+        for (usize i = 0; i < count; ++i)
+        {
+            const u32 sourceAlpha = source[i] >> 24;
+            u32 result = 0;
+
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                const u32 value = blendChannel<Mode>(getChannel(destination[i], channel), getChannel(source[i], channel), sourceAlpha, channel == 3);
+                result |= std::min(value, 255u) << (channel * 8);
+            }
+
+            destination[i] = result;
+        }
+    }
+
+    inline static void fillScalar(u32* pixels, const usize count, const u32 value)
+    {
+        std::fill(pixels, pixels + count, value);
+    }
+
+    inline static void blendScalar(u32* destination, const u32* source, const usize count, const BlendMode mode)
+    {
+        switch (mode)
+        {
+                // clang-format off
+            case BlendMode::opaque: std::copy(source, source + count, destination); break;
+            case BlendMode::alpha: blendScalar<BlendMode::alpha>(destination, source, count); break;
+            case BlendMode::premultiplied: blendScalar<BlendMode::premultiplied>(destination, source, count); break;
+            case BlendMode::additive: blendScalar<BlendMode::additive>(destination, source, count); break;
+            case BlendMode::multiply: blendScalar<BlendMode::multiply>(destination, source, count); break;
+            case BlendMode::screen: blendScalar<BlendMode::screen>(destination, source, count); break;
+            case BlendMode::subtract: blendScalar<BlendMode::subtract>(destination, source, count); break;
+                // clang-format on
+        }
+    }
+
+    inline static void tintScalar(u32* pixels, const usize count, const u32 tint)
+    {
+        for (usize i = 0; i < count; ++i)
+        {
+            u32 result = 0;
+
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                result |= div255(getChannel(pixels[i], channel) * getChannel(tint, channel)) << (channel * 8);
+            }
+
+            pixels[i] = result;
+        }
+    }
+
+    inline static void premultiplyScalar(u32* pixels, const usize count)
+    {
+        for (usize i = 0; i < count; ++i)
+        {
+            const u32 alpha = pixels[i] >> 24;
+            u32 result = alpha << 24;
+
+            for (u32 channel = 0; channel < 3; ++channel)
+            {
+                result |= div255(getChannel(pixels[i], channel) * alpha) << (channel * 8);
+            }
+
+            pixels[i] = result;
+        }
+    }
+
+    inline static void unpremultiplyScalar(u32* pixels, const usize count)
+    {
+        for (usize i = 0; i < count; ++i)
+        {
+            const u32 alpha = pixels[i] >> 24;
+            const f32 scale = alpha == 0 ? 0.0f : 255.0f / static_cast<f32>(alpha);
+            u32 result = alpha << 24;
+
+            for (u32 channel = 0; channel < 3; ++channel)
+            {
+                const u32 value = static_cast<u32>(static_cast<f32>(getChannel(pixels[i], channel)) * scale + 0.5f);
+                result |= std::min(value, 255u) << (channel * 8);
+            }
+
+            pixels[i] = result;
+        }
+    }
+
+    inline static void grayscaleScalar(u32* pixels, const usize count)
+    {
+        for (usize i = 0; i < count; ++i)
+        {
+            const u32 luminance = getLuminance(pixels[i]);
+            pixels[i] = (pixels[i] & 0xFF000000) | luminance << 16 | luminance << 8 | luminance;
+        }
+    }
+
+    inline static void invertScalar(u32* pixels, const usize count)
+    {
+        for (usize i = 0; i < count; ++i)
+        {
+            pixels[i] ^= 0x00FFFFFF;
+        }
+    }
+
+    inline static void thresholdScalar(u32* pixels, const usize count, const u8 level)
+    {
+        for (usize i = 0; i < count; ++i)
+        {
+            pixels[i] = (pixels[i] & 0xFF000000) | (getLuminance(pixels[i]) < level ? 0 : 0x00FFFFFF);
+        }
+    }
+
+    inline static constexpr PixelKernels s_scalarPixelKernels = {
+        .fill = &fillScalar,
+        .blend = &blendScalar,
+        .tint = &tintScalar,
+        .premultiply = &premultiplyScalar,
+        .unpremultiply = &unpremultiplyScalar,
+        .grayscale = &grayscaleScalar,
+        .invert = &invertScalar,
+        .threshold = &thresholdScalar,
+    };
+
+    const PixelKernels& getScalarPixelKernels()
+    {
+        return s_scalarPixelKernels;
+    }
+} // namespace processing
+
+namespace processing
+{
+    inline static bool isAvx2Supported()
+    {
+#if defined(_MSC_VER) and (defined(_M_X64) or defined(_M_IX86))
+        int info[4];
+        __cpuid(info, 1);
+        const bool hasAvx = (info[2] & (1 << 27)) != 0 and (info[2] & (1 << 28)) != 0;
+        if (not hasAvx or (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) or defined(__i386__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    const PixelKernels* findPixelKernels(const PixelKernelLevel level)
+    {
+        switch (level)
+        {
+                // clang-format off
+            case PixelKernelLevel::scalar: return &getScalarPixelKernels();
+            case PixelKernelLevel::sse2: return getSse2PixelKernels();
+            case PixelKernelLevel::avx2: return isAvx2Supported() ? getAvx2PixelKernels() : nullptr;
+                // clang-format on
+        }
+
+        return nullptr;
+    }
+
+    const PixelKernels& getPixelKernels()
+    {
+        static const PixelKernels& kernels = []() -> const PixelKernels&
+        {
+            for (const PixelKernelLevel level : {PixelKernelLevel::avx2, PixelKernelLevel::sse2})
+            {
+                if (const PixelKernels* kernels = findPixelKernels(level))
+                {
+                    return *kernels;
+                }
+            }
+
+            return getScalarPixelKernels();
+        }();
+
+        return kernels;
+    }
+} // namespace processing
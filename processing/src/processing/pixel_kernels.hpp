@@ -0,0 +1,40 @@
+#ifndef _PROCESSING_INCLUDE_PIXEL_KERNELS_HPP_
+#define _PROCESSING_INCLUDE_PIXEL_KERNELS_HPP_
+
+#include <processing/processing.hpp>
+
+namespace processing
+{
+    enum class PixelKernelLevel
+    {
+        scalar,
+        sse2,
+        avx2,
+    };
+
+    // Bulk operations on packed RGBA8 pixels. Blending follows the GL blend functions of each BlendMode.
+    // The kernels take plain pointers so the AVX2 translation unit instantiates no shared inline code.
+    struct PixelKernels
+    {
+        void (*fill)(u32* pixels, usize count, u32 value);
+        void (*blend)(u32* destination, const u32* source, usize count, BlendMode mode);
+        void (*tint)(u32* pixels, usize count, u32 tint);
+        void (*premultiply)(u32* pixels, usize count);
+        void (*unpremultiply)(u32* pixels, usize count);
+        void (*grayscale)(u32* pixels, usize count);
+        void (*invert)(u32* pixels, usize count);
+        void (*threshold)(u32* pixels, usize count, u8 level);
+    };
+
+    const PixelKernels& getScalarPixelKernels();
+    // Null when the kernels were not compiled for this architecture.
+    const PixelKernels* getSse2PixelKernels();
+    const PixelKernels* getAvx2PixelKernels();
+
+    // Null when the level is not compiled in or not supported by the CPU.
+    const PixelKernels* findPixelKernels(PixelKernelLevel level);
+    // The fastest kernels the CPU supports, selected on first use.
+    const PixelKernels& getPixelKernels();
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_PIXEL_KERNELS_HPP_
@@ -0,0 +1,84 @@
+#include <processing/pixel_kernels.hpp>
+
+// Built with -mavx2 or /arch:AVX2 and only called after getPixelKernels() has checked the CPU.
+#if defined(__AVX2__)
+
+#include <processing/pixel_kernels_simd.hpp>
+
+#include <immintrin.h>
+
+namespace processing
+{
+    struct Avx2Vector
+    {
+        using Integer = __m256i;
+        using Float = __m256;
+
+        inline static constexpr usize WIDTH = 8;
+
+        // clang-format off
+        static Integer load(const u32* pixels) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels)); }
+        static void store(u32* pixels, const Integer value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels), value); }
+
+        static Integer zero() { return _mm256_setzero_si256(); }
+        static Integer set16(const u16 value) { return _mm256_set1_epi16(static_cast<short>(value)); }
+        static Integer set32(const u32 value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+        static Integer set64(const u64 value) { return _mm256_set1_epi64x(static_cast<long long>(value)); }
+
+        static Integer unpackLow8(const Integer a, const Integer b) { return _mm256_unpacklo_epi8(a, b); }
+        static Integer unpackHigh8(const Integer a, const Integer b) { return _mm256_unpackhi_epi8(a, b); }
+        static Integer unpackLow16(const Integer a, const Integer b) { return _mm256_unpacklo_epi16(a, b); }
+        static Integer unpackHigh16(const Integer a, const Integer b) { return _mm256_unpackhi_epi16(a, b); }
+        static Integer packUnsigned16(const Integer a, const Integer b) { return _mm256_packus_epi16(a, b); }
+        static Integer packSigned32(const Integer a, const Integer b) { return _mm256_packs_epi32(a, b); }
+
+        static Integer add16(const Integer a, const Integer b) { return _mm256_add_epi16(a, b); }
+        static Integer sub16(const Integer a, const Integer b) { return _mm256_sub_epi16(a, b); }
+        static Integer subSaturated16(const Integer a, const Integer b) { return _mm256_subs_epu16(a, b); }
+        static Integer mul16(const Integer a, const Integer b) { return _mm256_mullo_epi16(a, b); }
+        static Integer shiftRight16By8(const Integer a) { return _mm256_srli_epi16(a, 8); }
+        static Integer broadcastAlpha16(const Integer a) { return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)); }
+
+        static Integer add32(const Integer a, const Integer b) { return _mm256_add_epi32(a, b); }
+        static Integer greaterThan32(const Integer a, const Integer b) { return _mm256_cmpgt_epi32(a, b); }
+        static Integer shiftRight32By8(const Integer a) { return _mm256_srli_epi32(a, 8); }
+        static Integer shiftRight32By16(const Integer a) { return _mm256_srli_epi32(a, 16); }
+        static Integer shiftLeft32By8(const Integer a) { return _mm256_slli_epi32(a, 8); }
+        static Integer shiftLeft32By16(const Integer a) { return _mm256_slli_epi32(a, 16); }
+
+        static Integer and_(const Integer a, const Integer b) { return _mm256_and_si256(a, b); }
+        static Integer andNot(const Integer a, const Integer b) { return _mm256_andnot_si256(a, b); }
+        static Integer or_(const Integer a, const Integer b) { return _mm256_or_si256(a, b); }
+        static Integer xor_(const Integer a, const Integer b) { return _mm256_xor_si256(a, b); }
+
+        static Float toFloat(const Integer a) { return _mm256_cvtepi32_ps(a); }
+        static Integer truncate(const Float a) { return _mm256_cvttps_epi32(a); }
+        static Float setFloat(const f32 value) { return _mm256_set1_ps(value); }
+        static Float addFloat(const Float a, const Float b) { return _mm256_add_ps(a, b); }
+        static Float mulFloat(const Float a, const Float b) { return _mm256_mul_ps(a, b); }
+        static Float divFloat(const Float a, const Float b) { return _mm256_div_ps(a, b); }
+        static Float andFloat(const Float a, const Float b) { return _mm256_and_ps(a, b); }
+        static Float notEqualFloat(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+        static Float broadcastAlpha32(const Float a) { return _mm256_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)); }
+        // clang-format on
+    };
+
+    inline static constexpr PixelKernels s_avx2PixelKernels = makePixelKernels<Avx2Vector>();
+
+    const PixelKernels* getAvx2PixelKernels()
+    {
+        return &s_avx2PixelKernels;
+    }
+} // namespace processing
+
+#else
+
+namespace processing
+{
+    const PixelKernels* getAvx2PixelKernels()
+    {
+        return nullptr;
+    }
+} // namespace processing
+
+#endif
@@ -0,0 +1,295 @@
+#ifndef _PROCESSING_INCLUDE_PIXEL_KERNELS_SIMD_HPP_
+#define _PROCESSING_INCLUDE_PIXEL_KERNELS_SIMD_HPP_
+
+#include <processing/pixel_kernels.hpp>
+
+// The kernels are written once against a vector type V that wraps the intrinsics of one
+// instruction set. Everything here has internal linkage, so each instruction set gets its own
+// copy and no AVX2 code can be picked for a CPU without it. Leftover pixels go to the scalar kernels.
+
+namespace processing
+{
+    template <typename V>
+    using VectorInteger = typename V::Integer;
+
+    template <typename V>
+    inline static VectorInteger<V> div255(const VectorInteger<V> value)
+    {
+        const VectorInteger<V> rounded = V::add16(value, V::set16(128));
+        return V::shiftRight16By8(V::add16(rounded, V::shiftRight16By8(rounded)));
+    }
+
+    template <typename V>
+    inline static VectorInteger<V> getLuminance(const VectorInteger<V> pixels)
+    {
+        // 32 bit lanes whose upper halves are zero, so 16 bit multiplies give the full product.
+        const VectorInteger<V> channelMask = V::set32(0xFF);
+        const VectorInteger<V> red = V::and_(pixels, channelMask);
+        const VectorInteger<V> green = V::and_(V::shiftRight32By8(pixels), channelMask);
+        const VectorInteger<V> blue = V::and_(V::shiftRight32By16(pixels), channelMask);
+
+        const VectorInteger<V> sum = V::add32(
+            V::add32(V::mul16(red, V::set32(54)), V::mul16(green, V::set32(183))),
+            V::add32(V::mul16(blue, V::set32(19)), V::set32(128))
+        );
+
+        return V::shiftRight32By8(sum);
+    }
+
+    // Widens the pixels to 16 bit channels, applies the operation and narrows them again with saturation.
+    template <typename V, typename Operation>
+    inline static usize transformChannels(u32* pixels, const usize count, const Operation& operation)
+    {
+        const VectorInteger<V> zero = V::zero();
+
+        usize i = 0;
+        for (; i + V::WIDTH <= count; i += V::WIDTH)
+        {
+            const VectorInteger<V> packed = V::load(pixels + i);
+            const VectorInteger<V> low = operation(V::unpackLow8(packed, zero));
+            const VectorInteger<V> high = operation(V::unpackHigh8(packed, zero));
+            V::store(pixels + i, V::packUnsigned16(low, high));
+        }
+
+        return i;
+    }
+
+    template <typename V, typename Operation>
+    inline static usize transformChannels(u32* destination, const u32* source, const usize count, const Operation& operation)
+    {
+        const VectorInteger<V> zero = V::zero();
+
+        usize i = 0;
+        for (; i + V::WIDTH <= count; i += V::WIDTH)
+        {
+            const VectorInteger<V> destinationPixels = V::load(destination + i);
+            const VectorInteger<V> sourcePixels = V::load(source + i);
+            const VectorInteger<V> low = operation(V::unpackLow8(destinationPixels, zero), V::unpackLow8(sourcePixels, zero));
+            const VectorInteger<V> high = operation(V::unpackHigh8(destinationPixels, zero), V::unpackHigh8(sourcePixels, zero));
+            V::store(destination + i, V::packUnsigned16(low, high));
+        }
+
+        return i;
+    }
+
+    // Matches blendChannel() of the scalar kernels lane by lane.
+    template <typename V, BlendMode Mode>
+    inline static VectorInteger<V> blendChannels(const VectorInteger<V> destination, const VectorInteger<V> source)
+    {
+        const VectorInteger<V> colorMask = V::set64(0x0000FFFFFFFFFFFF);
+        const VectorInteger<V> alphaMask = V::set64(0xFFFF000000000000);
+        const VectorInteger<V> alphaOne = V::set64(0x00FF000000000000);
+
+        const VectorInteger<V> sourceAlpha = V::broadcastAlpha16(source);
+        const VectorInteger<V> inverseSourceAlpha = V::sub16(V::set16(255), sourceAlpha);
+        const VectorInteger<V> sourceFactor = V::or_(V::and_(sourceAlpha, colorMask), alphaOne);
+
+        if constexpr (Mode == BlendMode::alpha)
+        {
+            return V::add16(div255<V>(V::mul16(source, sourceFactor)), div255<V>(V::mul16(destination, inverseSourceAlpha)));
+        }
+        else if constexpr (Mode == BlendMode::premultiplied)
+        {
+            return V::add16(source, div255<V>(V::mul16(destination, inverseSourceAlpha)));
+        }
+        else if constexpr (Mode == BlendMode::additive)
+        {
+            return V::add16(div255<V>(V::mul16(source, sourceFactor)), destination);
+        }
+        else if constexpr (Mode == BlendMode::multiply)
+        {
+            const VectorInteger<V> destinationFactor = V::or_(V::and_(destination, colorMask), alphaOne);
+            const VectorInteger<V> alpha = V::and_(div255<V>(V::mul16(destination, inverseSourceAlpha)), alphaMask);
+            return V::add16(div255<V>(V::mul16(source, destinationFactor)), alpha);
+        }
+        else if constexpr (Mode == BlendMode::screen)
+        {
+            return V::add16(source, div255<V>(V::mul16(destination, V::sub16(V::set16(255), source))));
+        }
+        else if constexpr (Mode == BlendMode::subtract)
+        {
+            const VectorInteger<V> color = V::subSaturated16(destination, div255<V>(V::mul16(source, sourceFactor)));
+            return V::or_(V::and_(color, colorMask), V::and_(V::add16(source, destination), alphaMask));
+        }
+        else
+        {
+            return source;
+        }
+    }
+
+    template <typename V>
+    inline static void fillPixels(u32* pixels, const usize count, const u32 value)
+    {
+        const VectorInteger<V> values = V::set32(value);
+
+        usize i = 0;
+        for (; i + V::WIDTH <= count; i += V::WIDTH)
+        {
+            V::store(pixels + i, values);
+        }
+
+        getScalarPixelKernels().fill(pixels + i, count - i, value);
+    }
+
+    template <typename V, BlendMode Mode>
+    inline static usize blendPixels(u32* destination, const u32* source, const usize count)
+    {
+        if constexpr (Mode == BlendMode::opaque)
+        {
+            usize i = 0;
+            for (; i + V::WIDTH <= count; i += V::WIDTH)
+            {
+                V::store(destination + i, V::load(source + i));
+            }
+
+            return i;
+        }
+
+        return transformChannels<V>(destination, source, count, [](const VectorInteger<V> d, const VectorInteger<V> s) { return blendChannels<V, Mode>(d, s); });
+    }
+
+    template <typename V>
+    inline static void blendPixels(u32* destination, const u32* source, const usize count, const BlendMode mode)
+    {
+        usize blended = 0;
+
+        switch (mode)
+        {
+                // clang-format off
+            case BlendMode::opaque: blended = blendPixels<V, BlendMode::opaque>(destination, source, count); break;
+            case BlendMode::alpha: blended = blendPixels<V, BlendMode::alpha>(destination, source, count); break;
+            case BlendMode::premultiplied: blended = blendPixels<V, BlendMode::premultiplied>(destination, source, count); break;
+            case BlendMode::additive: blended = blendPixels<V, BlendMode::additive>(destination, source, count); break;
+            case BlendMode::multiply: blended = blendPixels<V, BlendMode::multiply>(destination, source, count); break;
+            case BlendMode::screen: blended = blendPixels<V, BlendMode::screen>(destination, source, count); break;
+            case BlendMode::subtract: blended = blendPixels<V, BlendMode::subtract>(destination, source, count); break;
+                // clang-format on
+        }
+
+        getScalarPixelKernels().blend(destination + blended, source + blended, count - blended, mode);
+    }
+
+    template <typename V>
+    inline static void tintPixels(u32* pixels, const usize count, const u32 tint)
+    {
+        const VectorInteger<V> factor = V::unpackLow8(V::set32(tint), V::zero());
+        const usize tinted = transformChannels<V>(pixels, count, [&](const VectorInteger<V> channels) { return div255<V>(V::mul16(channels, factor)); });
+        getScalarPixelKernels().tint(pixels + tinted, count - tinted, tint);
+    }
+
+    template <typename V>
+    inline static void premultiplyPixels(u32* pixels, const usize count)
+    {
+        const VectorInteger<V> colorMask = V::set64(0x0000FFFFFFFFFFFF);
+        const VectorInteger<V> alphaOne = V::set64(0x00FF000000000000);
+
+        const usize premultiplied = transformChannels<V>(
+            pixels, count, [&](const VectorInteger<V> channels)
+            {
+                const VectorInteger<V> factor = V::or_(V::and_(V::broadcastAlpha16(channels), colorMask), alphaOne);
+                return div255<V>(V::mul16(channels, factor));
+            }
+        );
+
+        getScalarPixelKernels().premultiply(pixels + premultiplied, count - premultiplied);
+    }
+
+    template <typename V>
+    inline static VectorInteger<V> unpremultiplyChannels(const VectorInteger<V> channels)
+    {
+        const typename V::Float values = V::toFloat(channels);
+        const typename V::Float alpha = V::broadcastAlpha32(values);
+        const typename V::Float scale = V::andFloat(V::divFloat(V::setFloat(255.0f), alpha), V::notEqualFloat(alpha, V::setFloat(0.0f)));
+        return V::truncate(V::addFloat(V::mulFloat(values, scale), V::setFloat(0.5f)));
+    }
+
+    template <typename V>
+    inline static void unpremultiplyPixels(u32* pixels, const usize count)
+    {
+        const VectorInteger<V> zero = V::zero();
+        const VectorInteger<V> colorMask = V::set32(0x00FFFFFF);
+        const VectorInteger<V> alphaMask = V::set32(0xFF000000);
+
+        usize i = 0;
+        for (; i + V::WIDTH <= count; i += V::WIDTH)
+        {
+            const VectorInteger<V> packed = V::load(pixels + i);
+            const VectorInteger<V> low = V::unpackLow8(packed, zero);
+            const VectorInteger<V> high = V::unpackHigh8(packed, zero);
+
+            const VectorInteger<V> unpremultipliedLow = V::packSigned32(unpremultiplyChannels<V>(V::unpackLow16(low, zero)), unpremultiplyChannels<V>(V::unpackHigh16(low, zero)));
+            const VectorInteger<V> unpremultipliedHigh = V::packSigned32(unpremultiplyChannels<V>(V::unpackLow16(high, zero)), unpremultiplyChannels<V>(V::unpackHigh16(high, zero)));
+            const VectorInteger<V> unpremultiplied = V::packUnsigned16(unpremultipliedLow, unpremultipliedHigh);
+
+            V::store(pixels + i, V::or_(V::and_(unpremultiplied, colorMask), V::and_(packed, alphaMask)));
+        }
+
+        getScalarPixelKernels().unpremultiply(pixels + i, count - i);
+    }
+
+    template <typename V>
+    inline static void grayscalePixels(u32* pixels, const usize count)
+    {
+        const VectorInteger<V> alphaMask = V::set32(0xFF000000);
+
+        usize i = 0;
+        for (; i + V::WIDTH <= count; i += V::WIDTH)
+        {
+            const VectorInteger<V> packed = V::load(pixels + i);
+            const VectorInteger<V> luminance = getLuminance<V>(packed);
+            const VectorInteger<V> gray = V::or_(luminance, V::or_(V::shiftLeft32By8(luminance), V::shiftLeft32By16(luminance)));
+            V::store(pixels + i, V::or_(V::and_(packed, alphaMask), gray));
+        }
+
+        getScalarPixelKernels().grayscale(pixels + i, count - i);
+    }
+
+    template <typename V>
+    inline static void invertPixels(u32* pixels, const usize count)
+    {
+        const VectorInteger<V> colorMask = V::set32(0x00FFFFFF);
+
+        usize i = 0;
+        for (; i + V::WIDTH <= count; i += V::WIDTH)
+        {
+            V::store(pixels + i, V::xor_(V::load(pixels + i), colorMask));
+        }
+
+        getScalarPixelKernels().invert(pixels + i, count - i);
+    }
+
+    template <typename V>
+    inline static void thresholdPixels(u32* pixels, const usize count, const u8 level)
+    {
+        const VectorInteger<V> alphaMask = V::set32(0xFF000000);
+        const VectorInteger<V> colorMask = V::set32(0x00FFFFFF);
+        const VectorInteger<V> levels = V::set32(level);
+
+        usize i = 0;
+        for (; i + V::WIDTH <= count; i += V::WIDTH)
+        {
+            const VectorInteger<V> packed = V::load(pixels + i);
+            const VectorInteger<V> isBelow = V::greaterThan32(levels, getLuminance<V>(packed));
+            V::store(pixels + i, V::or_(V::and_(packed, alphaMask), V::andNot(isBelow, colorMask)));
+        }
+
+        getScalarPixelKernels().threshold(pixels + i, count - i, level);
+    }
+
+    template <typename V>
+    inline static constexpr PixelKernels makePixelKernels()
+    {
+        return PixelKernels{
+            .fill = &fillPixels<V>,
+            .blend = &blendPixels<V>,
+            .tint = &tintPixels<V>,
+            .premultiply = &premultiplyPixels<V>,
+            .unpremultiply = &unpremultiplyPixels<V>,
+            .grayscale = &grayscalePixels<V>,
+            .invert = &invertPixels<V>,
+            .threshold = &thresholdPixels<V>,
+        };
+    }
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_PIXEL_KERNELS_SIMD_HPP_
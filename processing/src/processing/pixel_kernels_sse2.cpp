@@ -0,0 +1,83 @@
+#include <processing/pixel_kernels.hpp>
+
+#if defined(__SSE2__) or defined(_M_X64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+
+#include <processing/pixel_kernels_simd.hpp>
+
+#include <emmintrin.h>
+
+namespace processing
+{
+    struct Sse2Vector
+    {
+        using Integer = __m128i;
+        using Float = __m128;
+
+        inline static constexpr usize WIDTH = 4;
+
+        // clang-format off
+        static Integer load(const u32* pixels) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)); }
+        static void store(u32* pixels, const Integer value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), value); }
+
+        static Integer zero() { return _mm_setzero_si128(); }
+        static Integer set16(const u16 value) { return _mm_set1_epi16(static_cast<short>(value)); }
+        static Integer set32(const u32 value) { return _mm_set1_epi32(static_cast<int>(value)); }
+        static Integer set64(const u64 value) { return _mm_set1_epi64x(static_cast<long long>(value)); }
+
+        static Integer unpackLow8(const Integer a, const Integer b) { return _mm_unpacklo_epi8(a, b); }
+        static Integer unpackHigh8(const Integer a, const Integer b) { return _mm_unpackhi_epi8(a, b); }
+        static Integer unpackLow16(const Integer a, const Integer b) { return _mm_unpacklo_epi16(a, b); }
+        static Integer unpackHigh16(const Integer a, const Integer b) { return _mm_unpackhi_epi16(a, b); }
+        static Integer packUnsigned16(const Integer a, const Integer b) { return _mm_packus_epi16(a, b); }
+        static Integer packSigned32(const Integer a, const Integer b) { return _mm_packs_epi32(a, b); }
+
+        static Integer add16(const Integer a, const Integer b) { return _mm_add_epi16(a, b); }
+        static Integer sub16(const Integer a, const Integer b) { return _mm_sub_epi16(a, b); }
+        static Integer subSaturated16(const Integer a, const Integer b) { return _mm_subs_epu16(a, b); }
+        static Integer mul16(const Integer a, const Integer b) { return _mm_mullo_epi16(a, b); }
+        static Integer shiftRight16By8(const Integer a) { return _mm_srli_epi16(a, 8); }
+        static Integer broadcastAlpha16(const Integer a) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)); }
+
+        static Integer add32(const Integer a, const Integer b) { return _mm_add_epi32(a, b); }
+        static Integer greaterThan32(const Integer a, const Integer b) { return _mm_cmpgt_epi32(a, b); }
+        static Integer shiftRight32By8(const Integer a) { return _mm_srli_epi32(a, 8); }
+        static Integer shiftRight32By16(const Integer a) { return _mm_srli_epi32(a, 16); }
+        static Integer shiftLeft32By8(const Integer a) { return _mm_slli_epi32(a, 8); }
+        static Integer shiftLeft32By16(const Integer a) { return _mm_slli_epi32(a, 16); }
+
+        static Integer and_(const Integer a, const Integer b) { return _mm_and_si128(a, b); }
+        static Integer andNot(const Integer a, const Integer b) { return _mm_andnot_si128(a, b); }
+        static Integer or_(const Integer a, const Integer b) { return _mm_or_si128(a, b); }
+        static Integer xor_(const Integer a, const Integer b) { return _mm_xor_si128(a, b); }
+
+        static Float toFloat(const Integer a) { return _mm_cvtepi32_ps(a); }
+        static Integer truncate(const Float a) { return _mm_cvttps_epi32(a); }
+        static Float setFloat(const f32 value) { return _mm_set1_ps(value); }
+        static Float addFloat(const Float a, const Float b) { return _mm_add_ps(a, b); }
+        static Float mulFloat(const Float a, const Float b) { return _mm_mul_ps(a, b); }
+        static Float divFloat(const Float a, const Float b) { return _mm_div_ps(a, b); }
+        static Float andFloat(const Float a, const Float b) { return _mm_and_ps(a, b); }
+        static Float notEqualFloat(const Float a, const Float b) { return _mm_cmpneq_ps(a, b); }
+        static Float broadcastAlpha32(const Float a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)); }
+        // clang-format on
+    };
+
+    inline static constexpr PixelKernels s_sse2PixelKernels = makePixelKernels<Sse2Vector>();
+
+    const PixelKernels* getSse2PixelKernels()
+    {
+        return &s_sse2PixelKernels;
+    }
+} // namespace processing
+
+#else
+
+namespace processing
+{
+    const PixelKernels* getSse2PixelKernels()
+    {
+        return nullptr;
+    }
+} // namespace processing
+
+#endif
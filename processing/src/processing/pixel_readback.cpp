@@ -0,0 +1,270 @@
+#include <processing/pixel_readback.hpp>
+#include <processing/graphics.hpp>
+#include <processing/state_cache.hpp>
+
+#include <GLFW/glfw3.h>
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace processing
+{
+    std::shared_ptr<PendingPixels> PendingPixels::create(PlatformImage* parent, const ResourceId textureId, const rect2u& region)
+    {
+        // Batched draws into the texture have to reach the GPU before it is read.
+        flushPendingDraws();
+
+        PixelReadbackPool& pool = getPixelReadbackPool();
+        const PixelReadbackPool::Buffer buffer = pool.acquireBuffer(static_cast<usize>(region.width) * region.height * 4);
+
+        getStateCache().bindReadFramebuffer(pool.getFramebufferId());
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureId.value, 0);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id.value);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(static_cast<GLint>(region.left), static_cast<GLint>(region.top), static_cast<GLsizei>(region.width), static_cast<GLsizei>(region.height), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // The framebuffer must not keep deleted textures alive.
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+        void* fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        std::shared_ptr<PendingPixels> request(new PendingPixels(parent, region.size, buffer.id, buffer.capacity, fence));
+        pool.track(request);
+        return request;
+    }
+
+    PendingPixels::~PendingPixels()
+    {
+        if (m_data.has_value())
+        {
+            return;
+        }
+
+        glDeleteSync(static_cast<GLsync>(m_fence));
+        getPixelReadbackPool().releaseBuffer(PixelReadbackPool::Buffer{.id = m_bufferId, .capacity = m_bufferCapacity});
+    }
+
+    bool PendingPixels::isReady()
+    {
+        if (glfwGetCurrentContext() == nullptr)
+        {
+            return isResolved();
+        }
+
+        return tryResolve();
+    }
+
+    Pixels PendingPixels::get()
+    {
+        if (glfwGetCurrentContext() != nullptr and not isResolved())
+        {
+            while (glClientWaitSync(static_cast<GLsync>(m_fence), GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000) == GL_TIMEOUT_EXPIRED)
+            {
+            }
+
+            resolve();
+        }
+
+        std::unique_lock lock(m_mutex);
+        m_resolved.wait(lock, [this] { return m_data.has_value(); });
+
+        // The request may be resolved more than once, so each Pixels gets its own copy.
+        return Pixels(m_size.x, m_size.y, m_parent, *m_data);
+    }
+
+    bool PendingPixels::tryResolve()
+    {
+        if (isResolved())
+        {
+            return true;
+        }
+
+        const GLenum result = glClientWaitSync(static_cast<GLsync>(m_fence), GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result != GL_ALREADY_SIGNALED and result != GL_CONDITION_SATISFIED)
+        {
+            return false;
+        }
+
+        resolve();
+        return true;
+    }
+
+    void PendingPixels::abandon()
+    {
+        if (not isResolved())
+        {
+            publish(std::vector<u32>(static_cast<usize>(m_size.x) * m_size.y, 0));
+        }
+    }
+
+    PendingPixels::PendingPixels(PlatformImage* parent, const uint2& size, const ResourceId bufferId, const usize bufferCapacity, void* fence)
+        : m_parent(parent),
+          m_size(size),
+          m_bufferId(bufferId),
+          m_bufferCapacity(bufferCapacity),
+          m_fence(fence),
+          m_mutex(),
+          m_resolved(),
+          m_data(std::nullopt)
+    {
+    }
+
+    bool PendingPixels::isResolved()
+    {
+        const std::lock_guard lock(m_mutex);
+        return m_data.has_value();
+    }
+
+    void PendingPixels::resolve()
+    {
+        const usize size = static_cast<usize>(m_size.x) * m_size.y * sizeof(u32);
+        std::vector<u32> data(static_cast<usize>(m_size.x) * m_size.y);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_bufferId.value);
+        if (const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT))
+        {
+            std::memcpy(data.data(), mapped, size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // The pixels live on the CPU now, the buffer can serve the next request.
+        glDeleteSync(static_cast<GLsync>(m_fence));
+        getPixelReadbackPool().releaseBuffer(PixelReadbackPool::Buffer{.id = m_bufferId, .capacity = m_bufferCapacity});
+
+        publish(std::move(data));
+    }
+
+    void PendingPixels::publish(std::vector<u32> data)
+    {
+        {
+            const std::lock_guard lock(m_mutex);
+            m_data = std::move(data);
+        }
+
+        m_resolved.notify_all();
+    }
+} // namespace processing
+
+namespace processing
+{
+    PixelReadbackPool::PixelReadbackPool()
+        : m_freeBuffers(),
+          m_framebufferId(std::nullopt),
+          m_pendingRequests()
+    {
+    }
+
+    void PixelReadbackPool::reset()
+    {
+        for (const std::shared_ptr<PendingPixels>& request : m_pendingRequests)
+        {
+            request->abandon();
+        }
+
+        m_pendingRequests.clear();
+        m_freeBuffers.clear();
+        m_framebufferId.reset();
+    }
+
+    PixelReadbackPool::Buffer PixelReadbackPool::acquireBuffer(const usize size)
+    {
+        // The smallest free buffer that fits, larger ones are kept for larger requests.
+        const auto best = std::ranges::min_element(m_freeBuffers, {}, [size](const Buffer& buffer) { return buffer.capacity >= size ? buffer.capacity : std::numeric_limits<usize>::max(); });
+        if (best != m_freeBuffers.end() and best->capacity >= size)
+        {
+            const Buffer buffer = *best;
+            m_freeBuffers.erase(best);
+            return buffer;
+        }
+
+        Buffer buffer = {.id = ResourceId{.value = 0}, .capacity = size};
+        glGenBuffers(1, &buffer.id.value);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id.value);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return buffer;
+    }
+
+    void PixelReadbackPool::releaseBuffer(const Buffer& buffer)
+    {
+        if (m_freeBuffers.size() < MAX_FREE_BUFFERS)
+        {
+            m_freeBuffers.push_back(buffer);
+            return;
+        }
+
+        glDeleteBuffers(1, &buffer.id.value);
+    }
+
+    ResourceId PixelReadbackPool::getFramebufferId()
+    {
+        if (not m_framebufferId.has_value())
+        {
+            ResourceId framebufferId = {.value = 0};
+            glGenFramebuffers(1, &framebufferId.value);
+            m_framebufferId = framebufferId;
+        }
+
+        return *m_framebufferId;
+    }
+
+    void PixelReadbackPool::track(std::shared_ptr<PendingPixels> request)
+    {
+        m_pendingRequests.push_back(std::move(request));
+    }
+
+    void PixelReadbackPool::resolveCompleted()
+    {
+        // Requests nobody holds any more give their buffer back without being copied out.
+        std::erase_if(m_pendingRequests, [](const std::shared_ptr<PendingPixels>& request) { return request.use_count() == 1 or request->tryResolve(); });
+    }
+
+    inline static PixelReadbackPool s_pixelReadbackPool;
+
+    PixelReadbackPool& getPixelReadbackPool()
+    {
+        return s_pixelReadbackPool;
+    }
+} // namespace processing
+
+namespace processing
+{
+    PixelsRequest::PixelsRequest()
+        : m_impl(nullptr)
+    {
+    }
+
+    PixelsRequest::PixelsRequest(std::shared_ptr<PendingPixels> impl)
+        : m_impl{std::move(impl)}
+    {
+    }
+
+    bool PixelsRequest::isReady() const
+    {
+        return m_impl == nullptr or m_impl->isReady();
+    }
+
+    std::optional<Pixels> PixelsRequest::tryGet() const
+    {
+        if (not isReady())
+        {
+            return std::nullopt;
+        }
+
+        return get();
+    }
+
+    Pixels PixelsRequest::get() const
+    {
+        if (m_impl == nullptr)
+        {
+            return Pixels(0, 0, nullptr, {});
+        }
+
+        return m_impl->get();
+    }
+} // namespace processing
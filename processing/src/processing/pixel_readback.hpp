@@ -0,0 +1,89 @@
+#ifndef _PROCESSING_INCLUDE_PIXEL_READBACK_HPP_
+#define _PROCESSING_INCLUDE_PIXEL_READBACK_HPP_
+
+#include <processing/processing.hpp>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace processing
+{
+    // A texture region copied into a pixel pack buffer, followed by a fence. The buffer is only
+    // mapped after the fence has signalled, so resolving a ready request never stalls. Threads
+    // without the GL context only see the pixels once the context thread has resolved them.
+    class PendingPixels
+    {
+    public:
+        static std::shared_ptr<PendingPixels> create(PlatformImage* parent, ResourceId textureId, const rect2u& region);
+
+        ~PendingPixels();
+
+        PendingPixels(const PendingPixels&) = delete;
+        PendingPixels& operator=(const PendingPixels&) = delete;
+
+        bool isReady();
+        Pixels get();
+
+        // Context thread only. Copies the pixels to the CPU once the fence has signalled.
+        bool tryResolve();
+        // The context is gone, waiting threads receive transparent pixels.
+        void abandon();
+
+    private:
+        explicit PendingPixels(PlatformImage* parent, const uint2& size, ResourceId bufferId, usize bufferCapacity, void* fence);
+
+        bool isResolved();
+        void resolve();
+        void publish(std::vector<u32> data);
+
+        PlatformImage* m_parent;
+        uint2 m_size;
+        ResourceId m_bufferId;
+        usize m_bufferCapacity;
+        void* m_fence;
+
+        std::mutex m_mutex;
+        std::condition_variable m_resolved;
+        std::optional<std::vector<u32>> m_data;
+    };
+} // namespace processing
+
+namespace processing
+{
+    // Pixel pack buffers are handed back after each readback and reused by the next request of
+    // the same or a smaller size.
+    class PixelReadbackPool
+    {
+    public:
+        inline static constexpr usize MAX_FREE_BUFFERS = 8;
+
+        struct Buffer
+        {
+            ResourceId id;
+            usize capacity;
+        };
+
+        PixelReadbackPool();
+
+        // Forgets the objects of a previous context without deleting them.
+        void reset();
+
+        Buffer acquireBuffer(usize size);
+        void releaseBuffer(const Buffer& buffer);
+        ResourceId getFramebufferId();
+
+        // The pool keeps every request until the context thread has resolved it, so the sketch
+        // thread of the pipelined mode neither polls fences nor releases buffers.
+        void track(std::shared_ptr<PendingPixels> request);
+        void resolveCompleted();
+
+    private:
+        std::vector<Buffer> m_freeBuffers;
+        std::optional<ResourceId> m_framebufferId;
+        std::vector<std::shared_ptr<PendingPixels>> m_pendingRequests;
+    };
+
+    PixelReadbackPool& getPixelReadbackPool();
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_PIXEL_READBACK_HPP_
@@ -1,13 +1,20 @@
 #include <processing/processing.hpp>
+#include <processing/frame_pipeline.hpp>
 #include <processing/graphics.hpp>
 #include <processing/image.hpp>
+#include <processing/pixel_readback.hpp>
 #include <processing/renderer.hpp>
 #include <processing/shader.hpp>
+#include <processing/state_cache.hpp>
+#include <processing/stream_buffer.hpp>
 
 #include <GLFW/glfw3.h>
 #include <glad/gl.h>
 
 #include <algorithm>
+#include <bitset>
+#include <charconv>
+#include <thread>
 
 namespace processing
 {
@@ -19,8 +26,18 @@ namespace processing
         bool isRedrawRequested;
         i32 exitCode;
         u64 frameCount;
+        std::bitset<32> hints;
+        u32 maxFramesInFlight = 2;
 
         GLFWwindow* window;
+        bool isHeadless;
+        u64 frameLimit;
+
+        // Only set while draw() runs on the sketch thread.
+        std::unique_ptr<InputQueue> inputQueue;
+        std::unique_ptr<FrameQueue> frameQueue;
+        bool isClosePending;
+        int2 mousePosition;
 
         ImageAssetHandler images;
         ShaderAssetHandler shaders;
@@ -31,175 +48,12 @@ namespace processing
     };
 
     inline static LibraryData s_data;
-} // namespace processing
-
-namespace processing
-{
-    matrix4x4::matrix4x4()
-        : data{
-              1.0f, 0.0f, 0.0f, 0.0f,
-              0.0f, 1.0f, 0.0f, 0.0f,
-              0.0f, 0.0f, 1.0f, 0.0f,
-              0.0f, 0.0f, 0.0f, 1.0f
-          }
-    {
-    }
-
-    matrix4x4::matrix4x4(
-        float m00, float m01, float m02, float m03,
-        float m10, float m11, float m12, float m13,
-        float m20, float m21, float m22, float m23,
-        float m30, float m31, float m32, float m33
-    )
-        : data{
-              m00, m01, m02, m03,
-              m10, m11, m12, m13,
-              m20, m21, m22, m23,
-              m30, m31, m32, m33
-          }
-    {
-    }
-
-    matrix4x4 matrix4x4::combined(const matrix4x4& other) const
-    {
-        matrix4x4 result;
-
-        for (int i = 0; i < 4; ++i)
-        {
-            for (int j = 0; j < 4; ++j)
-            {
-                result.data[i * 4 + j] =
-                    data[i * 4 + 0] * other.data[0 * 4 + j] +
-                    data[i * 4 + 1] * other.data[1 * 4 + j] +
-                    data[i * 4 + 2] * other.data[2 * 4 + j] +
-                    data[i * 4 + 3] * other.data[3 * 4 + j];
-            }
-        }
-
-        return result;
-    }
-
-    matrix4x4 matrix4x4::orthographic(f32 left, f32 top, f32 width, f32 height, f32 near, f32 far)
-    {
-        f32 right = left + width;
-        f32 bottom = top + height;
-
-        f32 rl = right - left;
-        f32 tb = top - bottom;
-        f32 fn = far - near;
-
-        return matrix4x4{
-            2.0f / rl, 0.0f, 0.0f, 0.0f,
-            0.0f, 2.0f / tb, 0.0f, 0.0f,
-            0.0f, 0.0f, -2.0f / fn, 0.0f,
-            -(right + left) / rl, -(top + bottom) / tb, -(far + near) / fn, 1.0f
-        };
-    }
-
-    matrix4x4 matrix4x4::translation(const f32 x, const f32 y)
-    {
-        return matrix4x4{
-            1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            x, y, 0.0f, 1.0f
-        };
-    }
-
-    matrix4x4 matrix4x4::scaling(const f32 x, const f32 y)
-    {
-        return matrix4x4{
-            x, 0.0f, 0.0f, 0.0f,
-            0.0f, y, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f
-        };
-    }
-
-    matrix4x4 matrix4x4::rotation(const f32 angle)
-    {
-        const f32 cos = std::cos(angle);
-        const f32 sin = std::sin(angle);
-
-        return matrix4x4{
-            cos, sin, 0.0f, 0.0f,
-            -sin, cos, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f
-        };
-    }
-
-    float2 matrix4x4::transformPoint(const float2& point) const
-    {
-        // f32 x = data[0] * point.x + data[1] * point.y + data[3];
-        // f32 y = data[4] * point.x + data[5] * point.y + data[7];
-        // f32 w = data[12] * point.x + data[13] * point.y + data[15];
-        //
-        // if (w != 0.0f && w != 1.0f)
-        // {
-        //     return float2(x / w, y / w);
-        // }
-        //
-        // return float2(x, y);
-
-        float x = data[0] * point.x + data[4] * point.y + data[12];
-        float y = data[1] * point.x + data[5] * point.y + data[13];
-        float w = data[3] * point.x + data[7] * point.y + data[15];
-
-        if (w != 0.0f && w != 1.0f)
-        {
-            return float2(x / w, y / w);
-        }
-
-        return float2(x, y);
-    }
-
-    float3 matrix4x4::transformPoint(const float3& point) const
-    {
-        float x = data[0] * point.x + data[4] * point.y + data[8] * point.z + data[12];
-        float y = data[1] * point.x + data[5] * point.y + data[9] * point.z + data[13];
-        float z = data[2] * point.x + data[6] * point.y + data[10] * point.z + data[14];
-        float w = data[3] * point.x + data[7] * point.y + data[11] * point.z + data[15];
 
-        if (w != 0.0f && w != 1.0f)
-        {
-            return float3(x / w, y / w, z / w);
-        }
-
-        return float3(x, y, z);
-    }
-
-    const matrix4x4 matrix4x4::identity;
-} // namespace processing
-
-namespace processing
-{
-    Color::Color()
-        : Color(255)
-    {
-    }
-    Color::Color(const i32 red, const i32 green, const i32 blue, const i32 alpha)
-        : r{static_cast<u8>(std::clamp(red, 0, 255))},
-          g{static_cast<u8>(std::clamp(green, 0, 255))},
-          b{static_cast<u8>(std::clamp(blue, 0, 255))},
-          a{static_cast<u8>(std::clamp(alpha, 0, 255))}
+    struct LaunchOptions
     {
-    }
-
-    Color::Color(const i32 grey, const i32 alpha)
-        : Color(grey, grey, grey, alpha)
-    {
-    }
-
-    i32 Color::brightness() const
-    {
-        const f32 r = 0.2126f * static_cast<f32>(r);
-        const f32 g = 0.7152f * static_cast<f32>(g);
-        const f32 b = 0.0722f * static_cast<f32>(b);
-        const f32 luminance = r + g + b;
-
-        return static_cast<i32>(luminance);
-    }
+        bool isHeadless;
+        u64 frameLimit;
+    };
 } // namespace processing
 
 namespace processing
@@ -232,13 +86,45 @@ namespace processing
     void setExitCode(const i32 exitCode) { s_data.exitCode = exitCode; }
     void loop() { s_data.isLoopPaused = false; }
     void noLoop() { s_data.isLoopPaused = true; }
+    bool isHeadless() { return s_data.isHeadless; }
     // clang-format on
 } // namespace processing
 
+namespace processing
+{
+    void hint(const Hint option, const bool enabled)
+    {
+        // The main thread reads the hints while it executes the previous frame.
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Hints cannot be changed while a pipelined frame is recorded");
+            fflush(stdout);
+            return;
+        }
+
+        s_data.hints.set(static_cast<usize>(option), enabled);
+    }
+
+    bool isHintEnabled(const Hint option)
+    {
+        return s_data.hints.test(static_cast<usize>(option));
+    }
+
+    void setMaxFramesInFlight(const u32 frameCount)
+    {
+        s_data.maxFramesInFlight = frameCount;
+    }
+} // namespace processing
+
 namespace processing
 {
     int2 getMousePosition()
     {
+        if (s_data.inputQueue != nullptr)
+        {
+            return s_data.mousePosition;
+        }
+
         double mx, my;
         glfwGetCursorPos(s_data.window, &mx, &my);
         return int2{static_cast<i32>(mx), static_cast<i32>(my)};
@@ -249,11 +135,30 @@ namespace processing
 {
     Image createImage(u32 width, u32 height, const u8* data, FilterMode filterMode, ExtendMode extendMode)
     {
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Images cannot be created while a pipelined frame is recorded");
+            fflush(stdout);
+            return Image{};
+        }
+
         return s_data.images.createImage(width, height, data, filterMode, extendMode);
     }
 
+    Image createStandaloneImage(u32 width, u32 height, const u8* data, FilterMode filterMode, ExtendMode extendMode)
+    {
+        return s_data.images.createImage(width, height, data, filterMode, extendMode, ImagePlacement::standalone);
+    }
+
     Image loadImage(const std::filesystem::path& filepath, FilterMode filterMode, ExtendMode extendMode)
     {
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Images cannot be loaded while a pipelined frame is recorded");
+            fflush(stdout);
+            return Image{};
+        }
+
         return s_data.images.loadImage(filepath, filterMode, extendMode);
     }
 } // namespace processing
@@ -262,14 +167,186 @@ namespace processing
 {
     Shader createShader(std::string_view vertexShaderSource, std::string_view fragmentShaderSource)
     {
+        if (getFrameEncoder() != nullptr)
+        {
+            fprintf(stdout, "Shaders cannot be created while a pipelined frame is recorded");
+            fflush(stdout);
+            return Shader(AssetId{.value = 0}, nullptr);
+        }
+
         return s_data.shaders.create(vertexShaderSource, fragmentShaderSource);
     }
 } // namespace processing
 
 namespace processing
 {
-    void launch()
+    void presentFrame()
+    {
+        if (s_data.isHeadless)
+        {
+            endDraw();
+            return;
+        }
+
+        int w, h;
+        glfwGetFramebufferSize(s_data.window, &w, &h);
+        endDraw(w, h);
+
+        {
+            const ProfileScope scope("glfwSwapBuffers");
+            glfwSwapBuffers(s_data.window);
+        }
+    }
+
+    void checkFrameLimit()
+    {
+        if (s_data.frameLimit != 0 and s_data.frameCount >= s_data.frameLimit)
+        {
+            s_data.closeRequested = true;
+        }
+    }
+} // namespace processing
+
+namespace processing
+{
+    void pushInputEvent(const InputEvent& event)
+    {
+        if (not s_data.inputQueue->push(event) and event.type == InputEventType::windowClosed)
+        {
+            s_data.isClosePending = true;
+        }
+    }
+
+    void handleInputEvents()
+    {
+        while (std::optional<InputEvent> event = s_data.inputQueue->pop())
+        {
+            switch (event->type)
+            {
+                    // clang-format off
+                case InputEventType::mouseMoved: s_data.mousePosition = event->position; break;
+                case InputEventType::windowClosed: s_data.closeRequested = true; break;
+                    // clang-format on
+            }
+        }
+    }
+
+    void runSketchThread()
+    {
+        while (not s_data.closeRequested)
+        {
+            handleInputEvents();
+            ++s_data.frameCount;
+
+            if (not s_data.isLoopPaused or s_data.isRedrawRequested or s_data.frameCount == 1)
+            {
+                std::optional<CommandEncoder> frame = s_data.frameQueue->acquire();
+                if (not frame.has_value())
+                {
+                    break;
+                }
+
+                beginFrameEncoding(*frame);
+                {
+                    const ProfileScope scope("Sketch::draw");
+                    s_data.sketch->draw(0.0f);
+                }
+                endFrameEncoding();
+
+                s_data.frameQueue->submit(std::move(*frame));
+                s_data.isRedrawRequested = false;
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            checkFrameLimit();
+        }
+
+        s_data.frameQueue->close();
+    }
+
+    // The window and its events stay on the main thread, which also owns the context and submits
+    // the frames the sketch thread has recorded.
+    void runPipelinedLoop()
     {
+        // Queried before the input queue exists, afterwards getMousePosition returns the cached value.
+        s_data.mousePosition = getMousePosition();
+        s_data.inputQueue = InputQueue::create();
+        s_data.frameQueue = FrameQueue::create(s_data.maxFramesInFlight);
+
+        glfwSetCursorPosCallback(
+            s_data.window, [](GLFWwindow*, const double x, const double y)
+            {
+                pushInputEvent(InputEvent{.type = InputEventType::mouseMoved, .position = int2{static_cast<i32>(x), static_cast<i32>(y)}});
+            }
+        );
+
+        std::thread sketchThread(runSketchThread);
+
+        while (not s_data.frameQueue->isDone())
+        {
+            glfwPollEvents();
+
+            // The sketch thread has no context, the pixel requests it waits for are resolved here.
+            getPixelReadbackPool().resolveCompleted();
+
+            if (s_data.isClosePending)
+            {
+                s_data.isClosePending = false;
+                pushInputEvent(InputEvent{.type = InputEventType::windowClosed, .position = {}});
+            }
+
+            if (std::optional<CommandEncoder> frame = s_data.frameQueue->pop(std::chrono::milliseconds(1)))
+            {
+                beginDraw();
+                {
+                    const ProfileScope scope("CommandEncoder::execute");
+                    frame->execute();
+                }
+                presentFrame();
+
+                s_data.frameQueue->recycle(std::move(*frame));
+            }
+        }
+
+        sketchThread.join();
+        glfwSetCursorPosCallback(s_data.window, nullptr);
+
+        s_data.frameQueue.reset();
+        s_data.inputQueue.reset();
+    }
+
+    // The null platform opens no window. Surfaceless EGL is tried first and OSMesa is the
+    // fallback, both render with Mesa's llvmpipe when there is no GPU.
+    GLFWwindow* createHeadlessWindow()
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        for (const int contextCreationApi : {GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API})
+        {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextCreationApi);
+
+            if (GLFWwindow* window = glfwCreateWindow(800, 800, "Processing App", nullptr, nullptr))
+            {
+                return window;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void launch(const LaunchOptions& options)
+    {
+        s_data.isHeadless = options.isHeadless;
+        s_data.frameLimit = options.frameLimit;
+
+        if (s_data.isHeadless)
+        {
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        }
+
         glfwInit();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
@@ -284,14 +361,31 @@ namespace processing
 
         // glfwWindowHint(GLFW_SAMPLES, 4);
         // glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-        s_data.window = glfwCreateWindow(800, 800, "Processing App", nullptr, nullptr);
+        s_data.window = s_data.isHeadless ? createHeadlessWindow() : glfwCreateWindow(800, 800, "Processing App", nullptr, nullptr);
+        if (s_data.window == nullptr)
+        {
+            fprintf(stdout, s_data.isHeadless ? "Failed to create a headless EGL or OSMesa context" : "Failed to create the window");
+            fflush(stdout);
+
+            setExitCode(1);
+            glfwTerminate();
+            return;
+        }
+
         glfwMakeContextCurrent(s_data.window);
-        glfwSwapInterval(1);
+        glfwSwapInterval(s_data.isHeadless ? 0 : 1);
 
         glfwSetWindowCloseCallback(
             s_data.window, [](GLFWwindow*)
             {
-                s_data.closeRequested = true;
+                if (s_data.inputQueue != nullptr)
+                {
+                    pushInputEvent(InputEvent{.type = InputEventType::windowClosed, .position = {}});
+                }
+                else
+                {
+                    s_data.closeRequested = true;
+                }
             }
         );
 
@@ -299,6 +393,9 @@ namespace processing
         glfwGetFramebufferSize(s_data.window, &w, &h);
 
         gladLoadGL(&glfwGetProcAddress);
+        loadStreamBufferFunctions(&glfwGetProcAddress);
+        getStateCache().reset();
+        getPixelReadbackPool().reset();
 
         glEnable(GL_BLEND);
         glEnable(GL_TEXTURE_2D);
@@ -310,8 +407,24 @@ namespace processing
 
         s_data.sketch = createSketch();
         beginDraw();
-        s_data.sketch->setup();
-        endDraw(w, h);
+        {
+            const ProfileScope scope("Sketch::setup");
+            s_data.sketch->setup();
+        }
+
+        if (s_data.isHeadless)
+        {
+            endDraw();
+        }
+        else
+        {
+            endDraw(w, h);
+        }
+
+        if (isHintEnabled(Hint::pipelinedRendering))
+        {
+            runPipelinedLoop();
+        }
 
         while (not s_data.closeRequested)
         {
@@ -319,17 +432,19 @@ namespace processing
 
             if (not s_data.isLoopPaused or s_data.isRedrawRequested or s_data.frameCount == 1)
             {
-                glfwGetFramebufferSize(s_data.window, &w, &h);
-
                 beginDraw();
-                s_data.sketch->draw(0.0f);
-                endDraw(w, h);
-                glfwSwapBuffers(s_data.window);
+                {
+                    const ProfileScope scope("Sketch::draw");
+                    s_data.sketch->draw(0.0f);
+                }
+                presentFrame();
 
                 s_data.isRedrawRequested = false;
             }
 
+            checkFrameLimit();
             glfwPollEvents();
+            getPixelReadbackPool().resolveCompleted();
         }
 
         s_data.sketch->destroy();
@@ -337,14 +452,46 @@ namespace processing
     }
 } // namespace processing
 
-int main()
+namespace processing
+{
+    // --headless renders without a window, --frames=<count> quits after that many frames.
+    LaunchOptions parseLaunchOptions(const int argc, char** argv)
+    {
+        LaunchOptions options = {.isHeadless = false, .frameLimit = 0};
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string_view argument = argv[i];
+
+            if (argument == "--headless")
+            {
+                options.isHeadless = true;
+            }
+            else if (argument.starts_with("--frames="))
+            {
+                const std::string_view value = argument.substr(std::string_view("--frames=").size());
+                if (std::from_chars(value.data(), value.data() + value.size(), options.frameLimit).ec != std::errc{})
+                {
+                    fprintf(stdout, "Invalid frame count %s", argv[i]);
+                    fflush(stdout);
+                }
+            }
+        }
+
+        return options;
+    }
+} // namespace processing
+
+int main(const int argc, char** argv)
 {
     using namespace processing;
 
+    const LaunchOptions options = parseLaunchOptions(argc, argv);
+
     do
     {
         s_data = {};
-        launch();
+        launch(options);
     } while (s_data.shouldRestart);
 
     return s_data.exitCode;
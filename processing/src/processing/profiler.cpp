@@ -0,0 +1,229 @@
+#include <processing/processing.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+namespace processing
+{
+    inline static constexpr usize TRACE_CHUNK_SIZE = 4096;
+    inline static constexpr usize TRACE_CHUNK_COUNT = 256;
+
+    struct TraceEvent
+    {
+        const char* name;
+        u64 startNanoseconds;
+        u64 durationNanoseconds;
+    };
+
+    struct TraceChunk
+    {
+        std::array<TraceEvent, TRACE_CHUNK_SIZE> events;
+    };
+
+    // Only its own thread writes to a buffer. The event count is published after the event, so
+    // stopTrace() reads complete events without locking. Chunks are kept between traces.
+    class ThreadTraceBuffer
+    {
+    public:
+        explicit ThreadTraceBuffer(const u32 threadIndex)
+            : m_threadIndex(threadIndex),
+              m_session(0),
+              m_eventCount(0),
+              m_droppedEvents(0),
+              m_chunks()
+        {
+        }
+
+        void write(const u64 session, const TraceEvent& event)
+        {
+            if (m_session.load(std::memory_order_relaxed) != session)
+            {
+                m_eventCount.store(0, std::memory_order_relaxed);
+                m_droppedEvents.store(0, std::memory_order_relaxed);
+                m_session.store(session, std::memory_order_release);
+            }
+
+            const usize eventCount = m_eventCount.load(std::memory_order_relaxed);
+            const usize chunkIndex = eventCount / TRACE_CHUNK_SIZE;
+            if (chunkIndex >= TRACE_CHUNK_COUNT)
+            {
+                m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            std::unique_ptr<TraceChunk>& chunk = m_chunks[chunkIndex];
+            if (chunk == nullptr)
+            {
+                chunk = std::make_unique<TraceChunk>();
+            }
+
+            chunk->events[eventCount % TRACE_CHUNK_SIZE] = event;
+            m_eventCount.store(eventCount + 1, std::memory_order_release);
+        }
+
+        usize getEventCount(const u64 session) const
+        {
+            return m_session.load(std::memory_order_acquire) == session ? m_eventCount.load(std::memory_order_acquire) : 0;
+        }
+
+        const TraceEvent& getEvent(const usize index) const
+        {
+            return m_chunks[index / TRACE_CHUNK_SIZE]->events[index % TRACE_CHUNK_SIZE];
+        }
+
+        u64 getDroppedEvents(const u64 session) const
+        {
+            return m_session.load(std::memory_order_acquire) == session ? m_droppedEvents.load(std::memory_order_relaxed) : 0;
+        }
+
+        u32 getThreadIndex() const
+        {
+            return m_threadIndex;
+        }
+
+    private:
+        u32 m_threadIndex;
+        std::atomic<u64> m_session;
+        std::atomic<usize> m_eventCount;
+        std::atomic<u64> m_droppedEvents;
+        std::array<std::unique_ptr<TraceChunk>, TRACE_CHUNK_COUNT> m_chunks;
+    };
+
+    struct TraceData
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers;
+        std::filesystem::path filepath;
+        std::chrono::steady_clock::time_point epoch;
+        u64 lastSession;
+        std::atomic<u64> activeSession;
+    };
+
+    inline static TraceData s_trace;
+    inline static thread_local ThreadTraceBuffer* s_threadTraceBuffer = nullptr;
+
+    inline static u64 getTraceTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_trace.epoch).count();
+    }
+
+    inline static ThreadTraceBuffer& getThreadTraceBuffer()
+    {
+        if (s_threadTraceBuffer == nullptr)
+        {
+            // Registration is the only locked step and happens once per thread.
+            const std::lock_guard lock(s_trace.mutex);
+            const u32 threadIndex = static_cast<u32>(s_trace.buffers.size());
+            s_threadTraceBuffer = s_trace.buffers.emplace_back(std::make_unique<ThreadTraceBuffer>(threadIndex)).get();
+        }
+
+        return *s_threadTraceBuffer;
+    }
+
+    inline static void writeEscaped(FILE* file, const char* text)
+    {
+        for (; *text != '\0'; ++text)
+        {
+            if (*text == '"' or *text == '\\')
+            {
+                std::fputc('\\', file);
+            }
+
+            std::fputc(*text, file);
+        }
+    }
+} // namespace processing
+
+namespace processing
+{
+    void startTrace(const std::filesystem::path& filepath)
+    {
+        if (isTracing())
+        {
+            stopTrace();
+        }
+
+        const std::lock_guard lock(s_trace.mutex);
+        s_trace.filepath = filepath;
+        s_trace.epoch = std::chrono::steady_clock::now();
+        s_trace.activeSession.store(++s_trace.lastSession, std::memory_order_release);
+    }
+
+    void stopTrace()
+    {
+        const u64 session = s_trace.activeSession.exchange(0, std::memory_order_acq_rel);
+        if (session == 0)
+        {
+            return;
+        }
+
+        const std::lock_guard lock(s_trace.mutex);
+
+        FILE* file = std::fopen(s_trace.filepath.string().c_str(), "w");
+        if (file == nullptr)
+        {
+            fprintf(stdout, "Failed to write trace to %s", s_trace.filepath.string().c_str());
+            fflush(stdout);
+            return;
+        }
+
+        std::fputs("{\"traceEvents\":[", file);
+
+        bool isFirstEvent = true;
+        u64 droppedEvents = 0;
+
+        for (const std::unique_ptr<ThreadTraceBuffer>& buffer : s_trace.buffers)
+        {
+            const usize eventCount = buffer->getEventCount(session);
+            droppedEvents += buffer->getDroppedEvents(session);
+
+            for (usize i = 0; i < eventCount; ++i)
+            {
+                const TraceEvent& event = buffer->getEvent(i);
+
+                std::fputs(isFirstEvent ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+                writeEscaped(file, event.name);
+                std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", buffer->getThreadIndex(), static_cast<f64>(event.startNanoseconds) / 1000.0, static_cast<f64>(event.durationNanoseconds) / 1000.0);
+                isFirstEvent = false;
+            }
+        }
+
+        std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+        std::fclose(file);
+
+        if (droppedEvents > 0)
+        {
+            fprintf(stdout, "The trace is full, %llu events have been dropped", static_cast<unsigned long long>(droppedEvents));
+            fflush(stdout);
+        }
+    }
+
+    bool isTracing()
+    {
+        return s_trace.activeSession.load(std::memory_order_relaxed) != 0;
+    }
+} // namespace processing
+
+namespace processing
+{
+    ProfileScope::ProfileScope(const char* name)
+        : m_name(name),
+          m_session(s_trace.activeSession.load(std::memory_order_acquire)),
+          m_startNanoseconds(m_session != 0 ? getTraceTime() : 0)
+    {
+    }
+
+    ProfileScope::~ProfileScope()
+    {
+        // Scopes that outlive their trace are dropped.
+        if (m_session == 0 or s_trace.activeSession.load(std::memory_order_acquire) != m_session)
+        {
+            return;
+        }
+
+        const u64 endNanoseconds = getTraceTime();
+        getThreadTraceBuffer().write(m_session, TraceEvent{.name = m_name, .startNanoseconds = m_startNanoseconds, .durationNanoseconds = endNanoseconds - m_startNanoseconds});
+    }
+} // namespace processing
@@ -0,0 +1,19 @@
+#include <processing/processing.hpp>
+
+namespace processing
+{
+    Recording::Recording()
+        : m_impl(nullptr)
+    {
+    }
+
+    Recording::Recording(std::shared_ptr<PlatformRecording> impl)
+        : m_impl{std::move(impl)}
+    {
+    }
+
+    usize Recording::getDrawCount() const
+    {
+        return m_impl != nullptr ? m_impl->getDrawCount() : 0;
+    }
+} // namespace processing
@@ -26,4 +26,9 @@ namespace processing
     {
         return m_impl->getAssetId();
     }
+
+    PixelsRequest Renderbuffer::loadPixelsAsync()
+    {
+        return m_impl->getImage().loadPixelsAsync();
+    }
 } // namespace processing
@@ -1,10 +1,48 @@
 #include <processing/renderer.hpp>
+#include <processing/cpu_timer.hpp>
+#include <processing/image.hpp>
+#include <processing/shader.hpp>
+#include <processing/state_cache.hpp>
+
 #include <glad/gl.h>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <numeric>
+
 namespace processing
 {
     inline static constexpr usize MAX_VERTICES = 10'000;
     inline static constexpr usize MAX_INDICES = 20'000;
+    inline static constexpr usize STREAM_BATCHES_PER_REGION = 4;
+    inline static constexpr usize MAX_INSTANCES = 4'096;
+    inline static constexpr u32 CIRCLE_SEGMENTS = 32;
+
+    inline static constexpr u32 MATRIX_PALETTE_BINDING = 1;
+    inline static constexpr u32 MATRIX_PALETTE_SIZE = 256; // Has to match u_Matrices in VS_SOURCE.
+    inline static constexpr u32 IDENTITY_MATRIX_INDEX = 0;
+    inline static constexpr u32 RECORDING_MATRIX_INDEX = 1;
+    inline static constexpr std::string_view MATRIX_PALETTE_BLOCK = "MatrixPalette";
+
+    // GL 4.1 guarantees at least 16 fragment texture units.
+    inline static constexpr u32 MAX_TEXTURE_SLOTS = 16;
+    inline static constexpr u32 UNTEXTURED_SLOT = 0xFFFF'FFFF;
+    inline static constexpr u32 COMPACT_TEXTURE_SLOT_BITS = 5;
+    inline static constexpr u32 COMPACT_UNTEXTURED_SLOT = (1u << COMPACT_TEXTURE_SLOT_BITS) - 1;
+    inline static constexpr std::string_view TEXTURE_SLOTS_UNIFORM = "u_Textures";
+} // namespace processing
+
+namespace processing
+{
+    struct FrameData
+    {
+        matrix4x4 projectionMatrix;
+    };
+
+    static_assert(sizeof(FrameData) == 64, "FrameData has to match the std140 layout of the shader block");
 } // namespace processing
 
 namespace processing
@@ -15,232 +53,1755 @@ namespace processing
 layout (location = 0) in vec3 a_Position;
 layout (location = 1) in vec2 a_TexCoord;
 layout (location = 2) in vec4 a_Color;
+layout (location = 3) in uint a_TextureSlot;
+layout (location = 4) in uint a_MatrixIndex;
 
 out vec2 v_TexCoord;
 out vec4 v_Color;
+flat out uint v_TextureSlot;
 
-uniform mat4 u_ProjectionMatrix;
+layout (std140) uniform FrameData {
+    mat4 u_ProjectionMatrix;
+};
+
+layout (std140) uniform MatrixPalette {
+    vec4 u_Matrices[2 * 256];
+};
 
 void main() {
-    gl_Position = u_ProjectionMatrix * vec4(a_Position.xyz, 1.0);
+    vec4 row0 = u_Matrices[2u * a_MatrixIndex];
+    vec4 row1 = u_Matrices[2u * a_MatrixIndex + 1u];
+    vec3 local = vec3(a_Position.xy, 1.0);
+    vec2 position = vec2(dot(row0.xyz, local), dot(row1.xyz, local));
+
+    // The unused w component offsets the depth, recordings store theirs relative to the first draw.
+    gl_Position = u_ProjectionMatrix * vec4(position, a_Position.z + row0.w, 1.0);
     v_TexCoord = a_TexCoord;
     v_Color = a_Color;
+    v_TextureSlot = a_TextureSlot;
 }
 )";
 
-    inline static constexpr std::string_view FS_SOURCE = R"(
+    inline static constexpr std::string_view COMPACT_VS_SOURCE = R"(
 #version 410
 
-layout (location = 0) out vec4 o_FragColor;
+layout (location = 0) in vec2 a_Position;
+layout (location = 1) in float a_Depth;
+layout (location = 2) in vec2 a_TexCoord;
+layout (location = 3) in vec4 a_Color;
+layout (location = 4) in uint a_TextureSlotAndMatrix;
 
-in vec2 v_TexCoord;
-in vec4 v_Color;
+out vec2 v_TexCoord;
+out vec4 v_Color;
+flat out uint v_TextureSlot;
+
+layout (std140) uniform FrameData {
+    mat4 u_ProjectionMatrix;
+};
+
+layout (std140) uniform MatrixPalette {
+    vec4 u_Matrices[2 * 256];
+};
+
+void main() {
+    uint matrixIndex = a_TextureSlotAndMatrix >> 5u;
+    vec3 local = vec3(a_Position, 1.0);
+    vec2 position = vec2(dot(u_Matrices[2u * matrixIndex].xyz, local), dot(u_Matrices[2u * matrixIndex + 1u].xyz, local));
+
+    gl_Position = u_ProjectionMatrix * vec4(position, a_Depth * 2.0 - 1.0, 1.0);
+    v_TexCoord = a_TexCoord;
+    v_Color = a_Color;
+    v_TextureSlot = a_TextureSlotAndMatrix & 31u;
+}
+)";
+
+    // Quads and circles share one mesh: a fan around the center whose rim is stored both on the
+    // unit circle and projected onto the unit square, so mixed instances stay in a single draw.
+    inline static constexpr std::string_view INSTANCED_VS_SOURCE = R"(
+#version 410
+
+layout (location = 0) in vec4 a_MeshPosition;
+layout (location = 1) in vec2 i_Origin;
+layout (location = 2) in vec2 i_AxisX;
+layout (location = 3) in vec2 i_AxisY;
+layout (location = 4) in float i_Depth;
+layout (location = 5) in uvec2 i_TextureSlotAndShape;
+layout (location = 6) in vec4 i_TexRect;
+layout (location = 7) in vec4 i_Color;
+
+out vec2 v_TexCoord;
+out vec4 v_Color;
+flat out uint v_TextureSlot;
 
-uniform sampler2D u_TextureSampler;
+layout (std140) uniform FrameData {
+    mat4 u_ProjectionMatrix;
+};
 
 void main() {
-    o_FragColor = texture(u_TextureSampler, v_TexCoord) * v_Color;
+    vec2 unit = i_TextureSlotAndShape.y == 0u ? a_MeshPosition.zw : a_MeshPosition.xy;
+    vec2 position = i_Origin + i_AxisX * unit.x + i_AxisY * unit.y;
+
+    gl_Position = u_ProjectionMatrix * vec4(position, i_Depth, 1.0);
+    v_TexCoord = i_TexRect.xy + i_TexRect.zw * unit;
+    v_Color = i_Color;
+    v_TextureSlot = i_TextureSlotAndShape.x;
 }
 )";
+
+    // Sampler arrays may only be indexed with dynamically uniform expressions in GLSL 4.10,
+    // so every slot gets its own case with a constant index.
+    inline static std::string buildFragmentShaderSource(const u32 slotCount)
+    {
+        std::string cases;
+        for (u32 slot = 0; slot < slotCount; ++slot)
+        {
+            cases += std::format("        case {0}u: return texture(u_Textures[{0}], v_TexCoord);\n", slot);
+        }
+
+        return std::format(R"(
+#version 410
+
+layout (location = 0) out vec4 o_FragColor;
+
+in vec2 v_TexCoord;
+in vec4 v_Color;
+flat in uint v_TextureSlot;
+
+uniform sampler2D u_Textures[{}];
+
+vec4 sampleTexture() {{
+    switch (v_TextureSlot) {{
+{}        default: return vec4(1.0);
+    }}
+}}
+
+void main() {{
+    o_FragColor = sampleTexture() * v_Color;
+}}
+)",
+                           slotCount, cases);
+    }
 } // namespace processing
 
 namespace processing
 {
-    void activate(const BlendMode mode)
+    inline static constexpr GLenum vertexModeToGlId(const VertexMode mode)
+    {
+        switch (mode)
+        {
+                // clang-format off
+            case VertexMode::points: return GL_POINTS;
+            case VertexMode::lines: return GL_LINES;
+            case VertexMode::lineStrip: return GL_LINE_STRIP;
+            case VertexMode::lineLoop: return GL_LINE_LOOP;
+            case VertexMode::triangles: return GL_TRIANGLES;
+            case VertexMode::triangleStrip: return GL_TRIANGLE_STRIP;
+            case VertexMode::triangleFan: return GL_TRIANGLE_FAN;
+                // clang-format on
+        }
+    }
+
+    inline static constexpr bool isListVertexMode(const VertexMode mode)
     {
         switch (mode)
         {
-            case BlendMode::opaque:
+            case VertexMode::points:
+            case VertexMode::lines:
+            case VertexMode::triangles:
+                return true;
+
+            case VertexMode::lineStrip:
+            case VertexMode::lineLoop:
+            case VertexMode::triangleStrip:
+            case VertexMode::triangleFan:
+                return false;
+        }
+    }
+
+    // Stable LSD radix sort over the full 64 bit key. Digits shared by every key are skipped.
+    inline static void radixSort(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch)
+    {
+        scratch.resize(entries.size());
+
+        for (u32 shift = 0; shift < 64; shift += 8)
+        {
+            std::array<usize, 256> offsets = {};
+            for (const DrawSortEntry& entry : entries)
             {
-                glDisable(GL_BLEND);
-                return;
+                ++offsets[(entry.key >> shift) & 0xFF];
             }
 
-            case BlendMode::alpha:
+            if (std::ranges::find(offsets, entries.size()) != offsets.end())
             {
-                glEnable(GL_BLEND);
-                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-                glBlendFuncSeparate(
-                    GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, // RGB
-                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA        // Alpha
-                );
-                break;
+                continue;
             }
 
-            case BlendMode::premultiplied:
+            usize offset = 0;
+            for (usize& bucket : offsets)
             {
-                glEnable(GL_BLEND);
-                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-                glBlendFuncSeparate(
-                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA, // RGB
-                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA  // Alpha
-                );
-                break;
+                const usize count = bucket;
+                bucket = offset;
+                offset += count;
             }
 
-            case BlendMode::additive:
+            for (const DrawSortEntry& entry : entries)
             {
-                glEnable(GL_BLEND);
-                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-                glBlendFuncSeparate(
-                    GL_SRC_ALPHA, GL_ONE, // RGB
-                    GL_ONE, GL_ONE        // Alpha
-                );
-                break;
+                scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
             }
 
-            case BlendMode::multiply:
+            entries.swap(scratch);
+        }
+    }
+
+    inline static ResourceId shaderIdOf(const std::optional<Shader>& shader, const Shader& fallback)
+    {
+        return shader.has_value() ? shader->getResourceId() : fallback.getResourceId();
+    }
+
+    inline static AffineTransform affineTransformOf(const matrix4x4& matrix)
+    {
+        return AffineTransform{
+            .row0 = float4{matrix.data[0], matrix.data[4], matrix.data[12], 0.0f},
+            .row1 = float4{matrix.data[1], matrix.data[5], matrix.data[13], 0.0f},
+        };
+    }
+
+    inline static u16 halfFromFloat(const f32 value)
+    {
+        const u32 bits = std::bit_cast<u32>(value);
+        const u32 sign = (bits >> 16) & 0x8000u;
+        const i32 exponent = static_cast<i32>((bits >> 23) & 0xFFu) - 127 + 15;
+        u32 mantissa = bits & 0x007F'FFFFu;
+
+        if (exponent >= 31)
+        {
+            return static_cast<u16>(sign | 0x7C00u);
+        }
+
+        if (exponent <= 0)
+        {
+            if (exponent < -10)
             {
-                glEnable(GL_BLEND);
-                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-                glBlendFuncSeparate(
-                    GL_DST_COLOR, GL_ZERO, // RGB
-                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA
-                );
-                break;
+                return static_cast<u16>(sign);
             }
 
-            case BlendMode::screen:
+            mantissa |= 0x0080'0000u;
+            const u32 shift = static_cast<u32>(14 - exponent);
+            const u32 half = mantissa >> shift;
+            const u32 remainder = mantissa & ((1u << shift) - 1u);
+            const u32 halfway = 1u << (shift - 1u);
+            return static_cast<u16>(sign | (half + (remainder > halfway or (remainder == halfway and (half & 1u)))));
+        }
+
+        // Round to nearest even, a carry into the exponent is still the correctly rounded result.
+        const u32 half = (static_cast<u32>(exponent) << 10) | (mantissa >> 13);
+        const u32 remainder = mantissa & 0x1FFFu;
+        return static_cast<u16>(sign | (half + (remainder > 0x1000u or (remainder == 0x1000u and (half & 1u)))));
+    }
+
+    inline static u16 depthToUnorm16(const f32 depth)
+    {
+        return static_cast<u16>(std::lround(std::clamp((depth + 1.0f) * 0.5f, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    inline static u16 packTextureSlotAndMatrix(const u32 textureSlot, const u32 matrixIndex)
+    {
+        const u32 slot = textureSlot == UNTEXTURED_SLOT ? COMPACT_UNTEXTURED_SLOT : textureSlot;
+        return static_cast<u16>((matrixIndex << COMPACT_TEXTURE_SLOT_BITS) | slot);
+    }
+
+    struct MeshVertex
+    {
+        float2 circle;
+        float2 square;
+    };
+
+    // Unit coordinates in [0, 1], the first vertex is the center of the fan.
+    inline static std::vector<MeshVertex> buildInstanceMesh()
+    {
+        std::vector<MeshVertex> mesh;
+        mesh.push_back(MeshVertex{.circle = float2{0.5f, 0.5f}, .square = float2{0.5f, 0.5f}});
+
+        for (u32 i = 0; i < CIRCLE_SEGMENTS; ++i)
+        {
+            const f32 angle = 2.0f * PI * static_cast<f32>(i) / static_cast<f32>(CIRCLE_SEGMENTS);
+            const float2 direction = float2{std::cos(angle), std::sin(angle)};
+            const f32 extent = std::max(std::abs(direction.x), std::abs(direction.y));
+
+            // Snap to the edges so that the corners of the square are hit exactly.
+            float2 square = float2{direction.x / extent, direction.y / extent};
+            square.x = std::abs(square.x) > 0.9999f ? std::copysign(1.0f, square.x) : square.x;
+            square.y = std::abs(square.y) > 0.9999f ? std::copysign(1.0f, square.y) : square.y;
+
+            mesh.push_back(MeshVertex{
+                .circle = float2{direction.x * 0.5f + 0.5f, direction.y * 0.5f + 0.5f},
+                .square = float2{square.x * 0.5f + 0.5f, square.y * 0.5f + 0.5f},
+            });
+        }
+
+        return mesh;
+    }
+
+    inline static std::vector<u32> buildInstanceMeshIndices()
+    {
+        std::vector<u32> indices;
+        indices.reserve(CIRCLE_SEGMENTS * 3);
+
+        for (u32 i = 1; i <= CIRCLE_SEGMENTS; ++i)
+        {
+            indices.push_back(0);
+            indices.push_back(i);
+            indices.push_back(i < CIRCLE_SEGMENTS ? i + 1 : 1);
+        }
+
+        return indices;
+    }
+
+    // CPU fallback for instances that end up in a geometry batch or use a custom shader.
+    inline static Vertices tessellateInstance(const InstanceShape shape, const Instance& instance)
+    {
+        Vertices vertices;
+        vertices.mode = VertexMode::triangles;
+
+        auto emit = [&](const float2& unit)
+        {
+            vertices.vertices.push_back(Vertex{
+                .position = float3{instance.origin + instance.axisX * unit.x + instance.axisY * unit.y, instance.depth},
+                .texcoord = float2{instance.texRect.left + instance.texRect.width * unit.x, instance.texRect.top + instance.texRect.height * unit.y},
+                .color = instance.color,
+            });
+        };
+
+        switch (shape)
+        {
+            case InstanceShape::quad:
             {
-                glEnable(GL_BLEND);
-                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-                glBlendFuncSeparate(
-                    GL_ONE, GL_ONE_MINUS_SRC_COLOR, // RGB
-                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA
-                );
-                break;
-            }
+                emit(float2{0.0f, 0.0f});
+                emit(float2{1.0f, 0.0f});
+                emit(float2{1.0f, 1.0f});
+                emit(float2{0.0f, 1.0f});
+                vertices.indices = {0, 1, 2, 2, 3, 0};
+            } break;
 
-            case BlendMode::subtract:
+            case InstanceShape::circle:
             {
-                glEnable(GL_BLEND);
-                glBlendEquationSeparate(GL_FUNC_REVERSE_SUBTRACT, GL_FUNC_ADD);
-                glBlendFuncSeparate(
-                    GL_SRC_ALPHA, GL_ONE, // RGB
-                    GL_ONE, GL_ONE
-                );
-                break;
-            }
+                static const std::vector<MeshVertex> mesh = buildInstanceMesh();
+                static const std::vector<u32> indices = buildInstanceMeshIndices();
+
+                for (const MeshVertex& vertex : mesh)
+                {
+                    emit(vertex.circle);
+                }
+
+                vertices.indices = indices;
+            } break;
         }
+
+        return vertices;
     }
-} // namespace processing
 
-namespace processing
-{
-    inline static constexpr GLenum vertexModeToGlId(const VertexMode mode)
+    inline static Shader createBatchShader(std::string_view vertexShaderSource, const u32 textureSlotCount)
     {
-        switch (mode)
+        Shader shader = createShader(vertexShaderSource, buildFragmentShaderSource(textureSlotCount));
+
+        std::array<GLint, MAX_TEXTURE_SLOTS> textureUnitIndices;
+        std::iota(textureUnitIndices.begin(), textureUnitIndices.end(), 0);
+        glProgramUniform1iv(shader.getResourceId().value, shader.getUniformLocation(TEXTURE_SLOTS_UNIFORM), static_cast<GLsizei>(textureSlotCount), textureUnitIndices.data());
+
+        return shader;
+    }
+
+    inline static void bindMatrixPalette(const Shader& shader)
+    {
+        const GLuint blockIndex = glGetUniformBlockIndex(shader.getResourceId().value, MATRIX_PALETTE_BLOCK.data());
+        if (blockIndex != GL_INVALID_INDEX)
         {
-                // clang-format off
-            case VertexMode::points: return GL_POINTS;
-            case VertexMode::lines: return GL_LINES;
-            case VertexMode::lineStrip: return GL_LINE_STRIP;
-            case VertexMode::lineLoop: return GL_LINE_LOOP;
-            case VertexMode::triangles: return GL_TRIANGLES;
-            case VertexMode::triangleStrip: return GL_TRIANGLE_STRIP;
-            case VertexMode::triangleFan: return GL_TRIANGLE_FAN;
-                // clang-format on
+            glUniformBlockBinding(shader.getResourceId().value, blockIndex, MATRIX_PALETTE_BINDING);
         }
     }
-} // namespace processing
 
-namespace processing
-{
-    std::unique_ptr<DefaultRenderer> DefaultRenderer::create()
+    inline static void setupVertexLayout(const ResourceId vertexArrayId, const VertexFormat format, const ResourceId vertexBufferId, const ResourceId indexBufferId)
+    {
+        GLStateCache& stateCache = getStateCache();
+        stateCache.bindVertexArray(vertexArrayId);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId.value);
+
+        switch (format)
+        {
+            case VertexFormat::full:
+            {
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (const GLvoid*)offsetof(BatchVertex, position));
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (const GLvoid*)offsetof(BatchVertex, texcoord));
+                glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BatchVertex), (const GLvoid*)offsetof(BatchVertex, color));
+                glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(BatchVertex), (const GLvoid*)offsetof(BatchVertex, textureSlot));
+                glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(BatchVertex), (const GLvoid*)offsetof(BatchVertex, matrixIndex));
+            } break;
+
+            case VertexFormat::compact:
+            {
+                glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(CompactBatchVertex), (const GLvoid*)offsetof(CompactBatchVertex, position));
+                glVertexAttribPointer(1, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactBatchVertex), (const GLvoid*)offsetof(CompactBatchVertex, depth));
+                glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactBatchVertex), (const GLvoid*)offsetof(CompactBatchVertex, texcoord));
+                glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompactBatchVertex), (const GLvoid*)offsetof(CompactBatchVertex, color));
+                glVertexAttribIPointer(4, 1, GL_UNSIGNED_SHORT, sizeof(CompactBatchVertex), (const GLvoid*)offsetof(CompactBatchVertex, textureSlotAndMatrix));
+            } break;
+        }
+
+        for (GLuint attribute = 0; attribute <= 4; ++attribute)
+        {
+            glEnableVertexAttribArray(attribute);
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId.value);
+
+        stateCache.bindVertexArray(ResourceId{.value = 0});
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    inline static CompactPipeline createCompactPipeline(const StreamBuffer& vertexStream, const StreamBuffer& indexStream, const u32 textureSlotCount)
     {
         ResourceId vertexArrayId = {.value = 0};
         glGenVertexArrays(1, &vertexArrayId.value);
-        glBindVertexArray(vertexArrayId.value);
+        setupVertexLayout(vertexArrayId, VertexFormat::compact, vertexStream.getResourceId(), indexStream.getResourceId());
 
-        ResourceId vertexBufferId = {.value = 0};
-        glGenBuffers(1, &vertexBufferId.value);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId.value);
-        glBufferData(GL_ARRAY_BUFFER, MAX_VERTICES * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, position));
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, texcoord));
-        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)offsetof(Vertex, color));
+        Shader shader = createBatchShader(COMPACT_VS_SOURCE, textureSlotCount);
+        bindMatrixPalette(shader);
+
+        return CompactPipeline{
+            .vertexArrayId = vertexArrayId,
+            .shader = std::move(shader),
+        };
+    }
+
+    inline static InstancePipeline createInstancePipeline(const u32 textureSlotCount)
+    {
+        GLStateCache& stateCache = getStateCache();
+
+        const std::vector<MeshVertex> mesh = buildInstanceMesh();
+        const std::vector<u32> indices = buildInstanceMeshIndices();
+
+        ResourceId vertexArrayId = {.value = 0};
+        glGenVertexArrays(1, &vertexArrayId.value);
+        stateCache.bindVertexArray(vertexArrayId);
+
+        ResourceId meshBufferId = {.value = 0};
+        glGenBuffers(1, &meshBufferId.value);
+        glBindBuffer(GL_ARRAY_BUFFER, meshBufferId.value);
+        glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(MeshVertex), mesh.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (const GLvoid*)0);
         glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
 
-        ResourceId elementBufferId = {.value = 0};
-        glGenBuffers(1, &elementBufferId.value);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferId.value);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, MAX_INDICES * sizeof(u32), nullptr, GL_DYNAMIC_DRAW);
+        ResourceId meshIndexBufferId = {.value = 0};
+        glGenBuffers(1, &meshIndexBufferId.value);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshIndexBufferId.value);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(u32), indices.data(), GL_STATIC_DRAW);
 
-        glBindVertexArray(0);
+        // The instance attribute pointers are set per draw, GL 4.1 has no base instance.
+        for (GLuint attribute = 1; attribute <= 7; ++attribute)
+        {
+            glVertexAttribDivisor(attribute, 1);
+            glEnableVertexAttribArray(attribute);
+        }
+
+        stateCache.bindVertexArray(ResourceId{.value = 0});
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
+        return InstancePipeline{
+            .vertexArrayId = vertexArrayId,
+            .meshBufferId = meshBufferId,
+            .meshIndexBufferId = meshIndexBufferId,
+            .meshIndexCount = static_cast<u32>(indices.size()),
+            .instanceStream = StreamBuffer::create(MAX_INSTANCES * sizeof(InstanceVertex) * STREAM_BATCHES_PER_REGION),
+            .shader = createBatchShader(INSTANCED_VS_SOURCE, textureSlotCount),
+        };
+    }
+
+} // namespace processing
+
+namespace processing
+{
+    std::unique_ptr<DefaultRenderer> DefaultRenderer::create()
+    {
+        std::unique_ptr<StreamBuffer> vertexStream = StreamBuffer::create(MAX_VERTICES * sizeof(BatchVertex) * STREAM_BATCHES_PER_REGION);
+        std::unique_ptr<StreamBuffer> indexStream = StreamBuffer::create(MAX_INDICES * sizeof(u32) * STREAM_BATCHES_PER_REGION);
+
+        ResourceId vertexArrayId = {.value = 0};
+        glGenVertexArrays(1, &vertexArrayId.value);
+        setupVertexLayout(vertexArrayId, VertexFormat::full, vertexStream->getResourceId(), indexStream->getResourceId());
+
+        ResourceId frameDataBufferId = {.value = 0};
+        glGenBuffers(1, &frameDataBufferId.value);
+        glBindBuffer(GL_UNIFORM_BUFFER, frameDataBufferId.value);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frameDataBufferId.value);
+
+        // Only the identity in the first slot is meaningful until a batch uploads its palette.
+        const AffineTransform identity = affineTransformOf(matrix4x4::identity);
+        ResourceId matrixPaletteBufferId = {.value = 0};
+        glGenBuffers(1, &matrixPaletteBufferId.value);
+        glBindBuffer(GL_UNIFORM_BUFFER, matrixPaletteBufferId.value);
+        glBufferData(GL_UNIFORM_BUFFER, MATRIX_PALETTE_SIZE * sizeof(AffineTransform), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(AffineTransform), &identity);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATRIX_PALETTE_BINDING, matrixPaletteBufferId.value);
+
         const u8 pixel[] = {255, 255, 255, 255};
-        Image whiteImage = createImage(1, 1, pixel, FilterMode::linear, ExtendMode::clamp);
-        Shader defaultShader = createShader(VS_SOURCE, FS_SOURCE);
+        Image whiteImage = createStandaloneImage(1, 1, pixel, FilterMode::linear, ExtendMode::clamp);
+
+        GLint textureUnits = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+        const u32 textureSlotCount = std::clamp(static_cast<u32>(textureUnits), 1u, MAX_TEXTURE_SLOTS);
+
+        Shader defaultShader = createBatchShader(VS_SOURCE, textureSlotCount);
+        bindMatrixPalette(defaultShader);
+
+        CompactPipeline compactPipeline = createCompactPipeline(*vertexStream, *indexStream, textureSlotCount);
+        InstancePipeline instancePipeline = createInstancePipeline(textureSlotCount);
+
+        return std::unique_ptr<DefaultRenderer>(new DefaultRenderer(vertexArrayId, std::move(vertexStream), std::move(indexStream), frameDataBufferId, matrixPaletteBufferId, std::move(whiteImage), std::move(defaultShader), std::move(compactPipeline), std::move(instancePipeline), textureSlotCount));
+    }
+
+    void DefaultRenderer::beginFrame()
+    {
+        getStateCache().resetStatistics();
+        m_submissionStats = SubmissionStats{};
+        m_submissionNanoseconds = 0;
 
-        return std::unique_ptr<DefaultRenderer>(new DefaultRenderer(vertexArrayId, vertexBufferId, elementBufferId, std::move(whiteImage), std::move(defaultShader)));
+        const ResourceId queryId = queryTimestamp();
+        m_frameTimerQuery = PendingTimerQuery{.beginQueryId = queryId, .endQueryId = queryId, .assetId = std::nullopt, .frameIndex = m_frameIndex};
     }
 
-    void DefaultRenderer::beginDraw(const Framebuffer& framebuffer)
+    void DefaultRenderer::endFrame()
     {
-        glViewport(0, 0, framebuffer.getSize().x, framebuffer.getSize().y);
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.getResourceId().value);
+        m_frameStats = getStateCache().getStatistics();
+        m_frameStats.vertexStream = m_vertexStream->getStatistics();
+        m_frameStats.indexStream = m_indexStream->getStatistics();
+        m_frameStats.instanceStream = m_instancePipeline.instanceStream->getStatistics();
+        m_frameStats.submission = m_submissionStats;
+        m_frameStats.cpuTime.submissionNanoseconds = m_submissionNanoseconds;
+
+        collectOcclusionQueries();
+        m_frameStats.opaquePass = m_occlusionStats;
+        m_occlusionStats = OcclusionStats{};
+
+        if (m_frameTimerQuery.has_value())
+        {
+            m_frameTimerQuery->endQueryId = queryTimestamp();
+            m_pendingTimerQueries.push_back(*m_frameTimerQuery);
+            m_frameTimerQuery.reset();
+        }
+
+        collectTimerQueries();
+        m_frameStats.gpuTime = m_gpuTimerStats;
+        m_frameStats.gpuTime.frameLatency = m_frameIndex - m_timedFrameIndex;
+
+        ++m_frameIndex;
+    }
+
+    void DefaultRenderer::beginDraw(const Framebuffer& framebuffer, const AssetId assetId)
+    {
+        flush();
+
+        const ResourceId queryId = queryTimestamp();
+        m_passTimerQuery = PendingTimerQuery{.beginQueryId = queryId, .endQueryId = queryId, .assetId = assetId, .frameIndex = m_frameIndex};
+
+        m_framebufferId = framebuffer.getResourceId();
+        m_framebufferSize = framebuffer.getSize();
+        setProjection(matrix4x4::orthographic(0.0f, 0.0f, m_framebufferSize.x, m_framebufferSize.y, -1.0f, 1.0f));
+
+        GLStateCache& stateCache = getStateCache();
+        stateCache.setViewport(m_framebufferSize);
+        stateCache.bindFramebuffer(m_framebufferId);
     }
 
     void DefaultRenderer::endDraw()
     {
-        // Nothing to do for now.
+        flush();
+
+        if (m_passTimerQuery.has_value())
+        {
+            m_passTimerQuery->endQueryId = queryTimestamp();
+            m_pendingTimerQueries.push_back(*m_passTimerQuery);
+            m_passTimerQuery.reset();
+        }
+    }
+
+    void DefaultRenderer::blit(const Framebuffer& framebuffer, const u32 width, const u32 height)
+    {
+        const ProfileScope scope("DefaultRenderer::blit");
+        flush();
+
+        GLStateCache& stateCache = getStateCache();
+        stateCache.setViewport(uint2{width, height});
+        stateCache.bindDrawFramebuffer(ResourceId{.value = 0});
+        stateCache.bindReadFramebuffer(framebuffer.getResourceId());
+        glBlitFramebuffer(0, 0, framebuffer.getSize().x, framebuffer.getSize().y, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
     }
 
     void DefaultRenderer::render(const Vertices& vertices, const RenderState& renderState)
     {
-        const ResourceId shaderId = std::invoke(
-            [this, &renderState]()
-            {
-                if (renderState.shader.has_value())
-                {
-                    return renderState.shader->getResourceId();
-                }
+        if (m_recording.has_value())
+        {
+            recordGeometry(vertices, renderState);
+            return;
+        }
 
-                return m_defaultShader.getResourceId();
-            }
-        );
+        commitShaderUniforms(renderState);
 
-        const ResourceId imageId = std::invoke(
-            [this, &renderState]()
-            {
-                if (renderState.image.has_value())
-                {
-                    return renderState.image->getResourceId();
-                }
+        if (isDeferring())
+        {
+            deferGeometry(vertices, renderState);
+            return;
+        }
 
-                return m_whiteImage.getResourceId();
-            }
-        );
+        submitGeometry(vertices.mode, vertices.vertices, vertices.indices, renderState);
+    }
 
-        activate(renderState.blendMode);
+    void DefaultRenderer::submitGeometry(const VertexMode mode, const std::span<const Vertex> vertices, const std::span<const u32> indices, const RenderState& renderState)
+    {
+        const std::optional<Image> texture = getBatchTexture(renderState);
 
-        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferId.value);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.vertices.size() * sizeof(Vertex), vertices.vertices.data());
+        if (not canAppendToBatch(mode, vertices.size(), indices.size(), renderState, texture))
+        {
+            flushBatch();
+        }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBufferId.value);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, vertices.indices.size() * sizeof(u32), vertices.indices.data());
+        if (isBatchEmpty())
+        {
+            m_batchPipeline = BatchPipeline::geometry;
+            m_batchFormat = getVertexFormat(renderState);
+            m_batchMode = mode;
+            m_batchState = RenderState{.blendMode = renderState.blendMode, .shader = renderState.shader, .image = std::nullopt, .transform = std::nullopt};
+        }
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, imageId.value);
+        const u32 textureSlot = acquireTextureSlot(texture);
+        const u32 matrixIndex = acquireMatrixIndex(renderState);
+        const u32 baseVertex = static_cast<u32>(getBatchVertexCount());
+        appendVertices(vertices, renderState, textureSlot, matrixIndex);
 
-        glUseProgram(shaderId.value);
-        glUniformMatrix4fv(glGetUniformLocation(shaderId.value, "u_ProjectionMatrix"), 1, GL_FALSE, renderState.transform.data.data());
-        glUniform1i(glGetUniformLocation(shaderId.value, "u_TextureSampler"), 0);
+        m_batchIndices.reserve(m_batchIndices.size() + indices.size());
+        for (const u32 index : indices)
+        {
+            m_batchIndices.push_back(baseVertex + index);
+        }
 
-        glBindVertexArray(m_vertexArrayId.value);
-        glDrawElements(vertexModeToGlId(vertices.mode), vertices.indices.size(), GL_UNSIGNED_INT, nullptr);
+        // Strips, fans and loops cannot be concatenated into a single draw call.
+        if (not isListVertexMode(mode))
+        {
+            flushBatch();
+        }
     }
 
-    DefaultRenderer::DefaultRenderer(ResourceId vertexArrayId, ResourceId vertexBufferId, ResourceId elementBufferId, Image whiteImage, Shader defaultShader)
-        : m_vertexArrayId(vertexArrayId),
-          m_vertexBufferId(vertexBufferId),
-          m_elementBufferId(elementBufferId),
-          m_whiteImage(std::move(whiteImage)),
-          m_defaultShader(std::move(defaultShader))
+    void DefaultRenderer::commitShaderUniforms(const RenderState& renderState)
+    {
+        if (not renderState.shader.has_value() or not renderState.shader->hasPendingUniforms())
+        {
+            return;
+        }
+
+        // Geometry batched with the old values has to be drawn before the new ones are uploaded.
+        if (isShaderPending(renderState.shader->getResourceId()))
+        {
+            flush();
+        }
+
+        Shader shader = *renderState.shader;
+        shader.commitUniforms();
+    }
+
+    bool DefaultRenderer::isShaderPending(const ResourceId shaderId) const
+    {
+        if (not m_batchIndices.empty() and shaderIdOf(m_batchState.shader, m_defaultShader) == shaderId)
+        {
+            return true;
+        }
+
+        return std::ranges::any_of(m_deferredDraws, [&](const DeferredDraw& draw)
+        {
+            return draw.state.shader.has_value() and draw.state.shader->getResourceId() == shaderId;
+        });
+    }
+
+    void DefaultRenderer::appendVertices(const std::span<const Vertex> vertices, const RenderState& renderState, const u32 textureSlot, const u32 matrixIndex)
+    {
+        if (m_batchFormat == VertexFormat::compact)
+        {
+            const u16 textureSlotAndMatrix = packTextureSlotAndMatrix(textureSlot, matrixIndex);
+            m_batchCompactVertices.reserve(m_batchCompactVertices.size() + vertices.size());
+
+            for (const Vertex& vertex : vertices)
+            {
+                m_batchCompactVertices.push_back(CompactBatchVertex{
+                    .position = float2{vertex.position.x, vertex.position.y},
+                    .depth = depthToUnorm16(vertex.position.z),
+                    .textureSlotAndMatrix = textureSlotAndMatrix,
+                    .texcoord = {halfFromFloat(vertex.texcoord.x), halfFromFloat(vertex.texcoord.y)},
+                    .color = vertex.color,
+                });
+            }
+
+            return;
+        }
+
+        // Custom shaders only know about world-space positions.
+        const bool transformOnCpu = renderState.transform.has_value() and renderState.shader.has_value();
+        m_batchVertices.reserve(m_batchVertices.size() + vertices.size());
+
+        for (const Vertex& vertex : vertices)
+        {
+            const float3 position = transformOnCpu ? float3{renderState.transform->transformPoint(float2{vertex.position.x, vertex.position.y}), vertex.position.z} : vertex.position;
+            m_batchVertices.push_back(BatchVertex{.position = position, .texcoord = vertex.texcoord, .color = vertex.color, .textureSlot = textureSlot, .matrixIndex = matrixIndex});
+        }
+    }
+
+    void DefaultRenderer::renderInstance(const InstanceShape shape, const Instance& instance, const RenderState& renderState)
+    {
+        if (m_recording.has_value())
+        {
+            recordGeometry(tessellateInstance(shape, instance), renderState);
+            return;
+        }
+
+        commitShaderUniforms(renderState);
+
+        if (isDeferring())
+        {
+            deferInstance(shape, instance, renderState);
+            return;
+        }
+
+        submitInstance(shape, instance, renderState);
+    }
+
+    void DefaultRenderer::submitInstance(const InstanceShape shape, const Instance& instance, const RenderState& renderState)
+    {
+        // Custom shaders expect the regular vertex layout, and an open geometry batch is
+        // cheaper to extend than to interrupt.
+        const bool hasGeometryBatch = m_batchPipeline == BatchPipeline::geometry and not m_batchIndices.empty();
+        if (renderState.shader.has_value() or hasGeometryBatch)
+        {
+            const Vertices vertices = tessellateInstance(shape, instance);
+            submitGeometry(vertices.mode, vertices.vertices, vertices.indices, renderState);
+            return;
+        }
+
+        const std::optional<Image> texture = getBatchTexture(renderState);
+
+        if (not canAppendInstance(renderState, texture))
+        {
+            flushBatch();
+        }
+
+        if (isBatchEmpty())
+        {
+            m_batchPipeline = BatchPipeline::instances;
+            m_batchState = RenderState{.blendMode = renderState.blendMode, .shader = std::nullopt, .image = std::nullopt, .transform = std::nullopt};
+        }
+
+        m_batchInstances.push_back(InstanceVertex{
+            .origin = instance.origin,
+            .axisX = instance.axisX,
+            .axisY = instance.axisY,
+            .depth = instance.depth,
+            .textureSlot = acquireTextureSlot(texture),
+            .shape = static_cast<u32>(shape),
+            .texRect = float4{instance.texRect.left, instance.texRect.top, instance.texRect.width, instance.texRect.height},
+            .color = instance.color,
+        });
+    }
+
+    void DefaultRenderer::deferGeometry(const Vertices& vertices, const RenderState& renderState)
+    {
+        const bool hasOpaqueColors = std::ranges::all_of(vertices.vertices, [](const Vertex& vertex)
+        {
+            return vertex.color.a == 255;
+        });
+
+        m_deferredDraws.push_back(DeferredDraw{
+            .pipeline = BatchPipeline::geometry,
+            .mode = vertices.mode,
+            .firstVertex = static_cast<u32>(m_deferredVertices.size()),
+            .vertexCount = static_cast<u32>(vertices.vertices.size()),
+            .firstIndex = static_cast<u32>(m_deferredIndices.size()),
+            .indexCount = static_cast<u32>(vertices.indices.size()),
+            .shape = InstanceShape::quad,
+            .instance = {},
+            .state = renderState,
+            .isOpaque = isOpaqueDraw(renderState, hasOpaqueColors),
+        });
+
+        m_deferredVertices.insert(m_deferredVertices.end(), vertices.vertices.begin(), vertices.vertices.end());
+        m_deferredIndices.insert(m_deferredIndices.end(), vertices.indices.begin(), vertices.indices.end());
+    }
+
+    void DefaultRenderer::deferInstance(const InstanceShape shape, const Instance& instance, const RenderState& renderState)
+    {
+        m_deferredDraws.push_back(DeferredDraw{
+            .pipeline = BatchPipeline::instances,
+            .mode = VertexMode::triangles,
+            .firstVertex = 0,
+            .vertexCount = 0,
+            .firstIndex = 0,
+            .indexCount = 0,
+            .shape = shape,
+            .instance = instance,
+            .state = renderState,
+            .isOpaque = isOpaqueDraw(renderState, instance.color.a == 255),
+        });
+    }
+
+    bool DefaultRenderer::isOpaqueDraw(const RenderState& renderState, const bool hasOpaqueColors) const
+    {
+        if (renderState.blendMode == BlendMode::opaque)
+        {
+            return true;
+        }
+
+        // Custom shaders may still produce translucent fragments.
+        const bool isBlendNeutral = renderState.blendMode == BlendMode::alpha or renderState.blendMode == BlendMode::premultiplied;
+        const bool hasOpaqueTexture = not renderState.image.has_value() or renderState.image->isOpaque();
+        return isBlendNeutral and hasOpaqueColors and hasOpaqueTexture and not renderState.shader.has_value();
+    }
+
+    bool DefaultRenderer::isDeferring() const
+    {
+        return isHintEnabled(Hint::sortOpaqueDraws) or isHintEnabled(Hint::frontToBackOpaque);
+    }
+
+    u64 DefaultRenderer::getSortKey(const DeferredDraw& draw) const
+    {
+        // Instances go first so that the geometry batch does not absorb them, see submitInstance().
+        const bool isInstanced = draw.pipeline == BatchPipeline::instances and not draw.state.shader.has_value();
+        const std::optional<Image> texture = getBatchTexture(draw.state);
+
+        const u64 pipeline = isInstanced ? 0 : 1;
+        const u64 format = static_cast<u64>(getVertexFormat(draw.state));
+        const u64 mode = static_cast<u64>(draw.mode);
+        const u64 blendMode = static_cast<u64>(draw.state.blendMode);
+        const u64 shaderId = shaderIdOf(draw.state.shader, m_defaultShader).value & 0xFF'FFFF;
+        const u64 textureId = texture.has_value() ? texture->getResourceId().value : 0;
+
+        return pipeline << 63 | format << 62 | mode << 59 | blendMode << 56 | shaderId << 32 | textureId;
+    }
+
+    void DefaultRenderer::submitDeferredDraws()
+    {
+        if (m_deferredDraws.empty())
+        {
+            return;
+        }
+
+        // Every draw carries a unique depth, so the depth test keeps opaque draws correct in any order.
+        m_sortEntries.clear();
+        for (u32 index = 0; index < m_deferredDraws.size(); ++index)
+        {
+            if (m_deferredDraws[index].isOpaque)
+            {
+                m_sortEntries.push_back(DrawSortEntry{.key = getSortKey(m_deferredDraws[index]), .index = index});
+            }
+        }
+
+        if (isHintEnabled(Hint::frontToBackOpaque))
+        {
+            // Later draws are nearer, so reversing the submission order lets early depth testing reject hidden fragments.
+            std::ranges::reverse(m_sortEntries);
+        }
+        else
+        {
+            radixSort(m_sortEntries, m_sortScratch);
+        }
+
+        const bool measureOcclusion = isHintEnabled(Hint::frontToBackOpaque) and not m_sortEntries.empty();
+        u64 coveredFragments = 0;
+
+        if (measureOcclusion)
+        {
+            const ResourceId queryId = acquireOcclusionQuery();
+            glBeginQuery(GL_SAMPLES_PASSED, queryId.value);
+            m_pendingOcclusionQueries.push_back(PendingOcclusionQuery{.queryId = queryId, .coveredFragments = 0});
+        }
+
+        for (const DrawSortEntry& entry : m_sortEntries)
+        {
+            const DeferredDraw& draw = m_deferredDraws[entry.index];
+            submitDeferredDraw(draw);
+
+            if (measureOcclusion)
+            {
+                coveredFragments += estimateCoverage(draw);
+            }
+        }
+
+        if (measureOcclusion)
+        {
+            flushBatch();
+            glEndQuery(GL_SAMPLES_PASSED);
+            m_pendingOcclusionQueries.back().coveredFragments = coveredFragments;
+        }
+
+        // Translucent draws blend with whatever lies beneath them and have to keep their order.
+        for (const DeferredDraw& draw : m_deferredDraws)
+        {
+            if (not draw.isOpaque)
+            {
+                submitDeferredDraw(draw);
+            }
+        }
+
+        m_deferredDraws.clear();
+        m_deferredVertices.clear();
+        m_deferredIndices.clear();
+    }
+
+    u64 DefaultRenderer::estimateCoverage(const DeferredDraw& draw) const
+    {
+        f32 area = 0.0f;
+
+        if (draw.pipeline == BatchPipeline::instances)
+        {
+            const f32 scale = std::abs(draw.instance.axisX.x * draw.instance.axisY.y - draw.instance.axisX.y * draw.instance.axisY.x);
+            area = draw.shape == InstanceShape::circle ? scale * PI * 0.25f : scale;
+        }
+        else
+        {
+            const auto positionAt = [&](const u32 index)
+            {
+                return m_deferredVertices[draw.firstVertex + m_deferredIndices[draw.firstIndex + index]].position;
+            };
+
+            const auto triangleArea = [&](const u32 a, const u32 b, const u32 c)
+            {
+                const float3 pa = positionAt(a);
+                const float3 pb = positionAt(b);
+                const float3 pc = positionAt(c);
+                return std::abs((pb.x - pa.x) * (pc.y - pa.y) - (pc.x - pa.x) * (pb.y - pa.y)) * 0.5f;
+            };
+
+            // Points and lines cover too little to matter and are not counted.
+            for (u32 index = 0; index + 2 < draw.indexCount; index += draw.mode == VertexMode::triangles ? 3 : 1)
+            {
+                switch (draw.mode)
+                {
+                    case VertexMode::triangles:
+                    case VertexMode::triangleStrip:
+                        area += triangleArea(index, index + 1, index + 2);
+                        break;
+                    case VertexMode::triangleFan:
+                        area += triangleArea(0, index + 1, index + 2);
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            if (draw.state.transform.has_value())
+            {
+                const float2 origin = draw.state.transform->transformPoint(float2{0.0f, 0.0f});
+                const float2 axisX = draw.state.transform->transformPoint(float2{1.0f, 0.0f}) - origin;
+                const float2 axisY = draw.state.transform->transformPoint(float2{0.0f, 1.0f}) - origin;
+                area *= std::abs(axisX.x * axisY.y - axisX.y * axisY.x);
+            }
+        }
+
+        // The projection maps one unit to one pixel. Only the part of the screen bounds inside the
+        // framebuffer is rasterized, the area is scaled by that fraction.
+        float2 boundsMin = float2{std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max()};
+        float2 boundsMax = float2{std::numeric_limits<f32>::lowest(), std::numeric_limits<f32>::lowest()};
+        const auto extendBounds = [&](const float2& point)
+        {
+            boundsMin = float2{std::min(boundsMin.x, point.x), std::min(boundsMin.y, point.y)};
+            boundsMax = float2{std::max(boundsMax.x, point.x), std::max(boundsMax.y, point.y)};
+        };
+
+        if (draw.pipeline == BatchPipeline::instances)
+        {
+            extendBounds(draw.instance.origin);
+            extendBounds(draw.instance.origin + draw.instance.axisX);
+            extendBounds(draw.instance.origin + draw.instance.axisY);
+            extendBounds(draw.instance.origin + draw.instance.axisX + draw.instance.axisY);
+        }
+        else
+        {
+            for (u32 index = 0; index < draw.indexCount; ++index)
+            {
+                const float3 position = m_deferredVertices[draw.firstVertex + m_deferredIndices[draw.firstIndex + index]].position;
+                const float2 point = float2{position.x, position.y};
+                extendBounds(draw.state.transform.has_value() ? draw.state.transform->transformPoint(point) : point);
+            }
+        }
+
+        const f32 boundsArea = (boundsMax.x - boundsMin.x) * (boundsMax.y - boundsMin.y);
+        const f32 visibleWidth = std::min(boundsMax.x, static_cast<f32>(m_framebufferSize.x)) - std::max(boundsMin.x, 0.0f);
+        const f32 visibleHeight = std::min(boundsMax.y, static_cast<f32>(m_framebufferSize.y)) - std::max(boundsMin.y, 0.0f);
+        if (area <= 0.0f or boundsArea <= 0.0f or visibleWidth <= 0.0f or visibleHeight <= 0.0f)
+        {
+            return 0;
+        }
+
+        const f32 visibleArea = area * std::min(visibleWidth * visibleHeight / boundsArea, 1.0f);
+        return static_cast<u64>(std::min(visibleArea, visibleWidth * visibleHeight));
+    }
+
+    ResourceId DefaultRenderer::acquireOcclusionQuery()
+    {
+        collectOcclusionQueries();
+
+        if (m_freeOcclusionQueries.empty())
+        {
+            ResourceId queryId = {.value = 0};
+            glGenQueries(1, &queryId.value);
+            return queryId;
+        }
+
+        const ResourceId queryId = m_freeOcclusionQueries.back();
+        m_freeOcclusionQueries.pop_back();
+        return queryId;
+    }
+
+    void DefaultRenderer::collectOcclusionQueries()
+    {
+        // Results arrive in submission order, so polling stops at the first query that is still in flight.
+        while (not m_pendingOcclusionQueries.empty())
+        {
+            const PendingOcclusionQuery& query = m_pendingOcclusionQueries.front();
+
+            GLuint isAvailable = GL_FALSE;
+            glGetQueryObjectuiv(query.queryId.value, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+            if (isAvailable == GL_FALSE)
+            {
+                break;
+            }
+
+            GLuint64 passedFragments = 0;
+            glGetQueryObjectui64v(query.queryId.value, GL_QUERY_RESULT, &passedFragments);
+
+            m_occlusionStats.coveredFragments += query.coveredFragments;
+            m_occlusionStats.passedFragments += passedFragments;
+            m_occlusionStats.rejectedFragments += query.coveredFragments > passedFragments ? query.coveredFragments - passedFragments : 0;
+
+            m_freeOcclusionQueries.push_back(query.queryId);
+            m_pendingOcclusionQueries.pop_front();
+        }
+    }
+
+    ResourceId DefaultRenderer::queryTimestamp()
+    {
+        ResourceId queryId = {.value = 0};
+
+        if (m_freeTimerQueries.empty())
+        {
+            glGenQueries(1, &queryId.value);
+        }
+        else
+        {
+            queryId = m_freeTimerQueries.back();
+            m_freeTimerQueries.pop_back();
+        }
+
+        glQueryCounter(queryId.value, GL_TIMESTAMP);
+        return queryId;
+    }
+
+    void DefaultRenderer::collectTimerQueries()
+    {
+        // Passes are queued before the frame they belong to, so a frame entry completes everything collected since the previous one.
+        while (not m_pendingTimerQueries.empty())
+        {
+            const PendingTimerQuery& query = m_pendingTimerQueries.front();
+
+            GLuint isAvailable = GL_FALSE;
+            glGetQueryObjectuiv(query.endQueryId.value, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+            if (isAvailable == GL_FALSE)
+            {
+                break;
+            }
+
+            GLuint64 beginTime = 0;
+            GLuint64 endTime = 0;
+            glGetQueryObjectui64v(query.beginQueryId.value, GL_QUERY_RESULT, &beginTime);
+            glGetQueryObjectui64v(query.endQueryId.value, GL_QUERY_RESULT, &endTime);
+            const u64 nanoseconds = endTime > beginTime ? endTime - beginTime : 0;
+
+            if (query.assetId.has_value())
+            {
+                // A renderbuffer that is pushed several times per frame adds up all of its passes.
+                const auto timing = std::ranges::find(m_collectedTimings, *query.assetId, &RenderbufferTiming::assetId);
+                if (timing != m_collectedTimings.end())
+                {
+                    timing->nanoseconds += nanoseconds;
+                }
+                else
+                {
+                    m_collectedTimings.push_back(RenderbufferTiming{.assetId = *query.assetId, .nanoseconds = nanoseconds});
+                }
+            }
+            else
+            {
+                m_gpuTimerStats.frameNanoseconds = nanoseconds;
+                m_timedFrameIndex = query.frameIndex;
+                m_gpuTimerStats.renderbuffers.swap(m_collectedTimings);
+                m_collectedTimings.clear();
+            }
+
+            m_freeTimerQueries.push_back(query.beginQueryId);
+            m_freeTimerQueries.push_back(query.endQueryId);
+            m_pendingTimerQueries.pop_front();
+        }
+    }
+
+    void DefaultRenderer::submitDeferredDraw(const DeferredDraw& draw)
+    {
+        switch (draw.pipeline)
+        {
+            case BatchPipeline::geometry:
+            {
+                const std::span<const Vertex> vertices = std::span{m_deferredVertices}.subspan(draw.firstVertex, draw.vertexCount);
+                const std::span<const u32> indices = std::span{m_deferredIndices}.subspan(draw.firstIndex, draw.indexCount);
+                submitGeometry(draw.mode, vertices, indices, draw.state);
+            } break;
+
+            case BatchPipeline::instances:
+            {
+                submitInstance(draw.shape, draw.instance, draw.state);
+            } break;
+        }
+    }
+
+    void DefaultRenderer::clear()
+    {
+        // Recordings only capture geometry, the target must not be wiped while nothing is drawn.
+        if (m_recording.has_value())
+        {
+            return;
+        }
+
+        // Pending geometry has been submitted before the clear and must not end up on top of it.
+        flush();
+
+        GLStateCache& stateCache = getStateCache();
+        stateCache.setViewport(m_framebufferSize);
+        stateCache.bindFramebuffer(m_framebufferId);
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    void DefaultRenderer::flush()
+    {
+        submitDeferredDraws();
+        flushBatch();
+    }
+
+    void DefaultRenderer::flushBatch()
+    {
+        // One zone per submitted batch, render() runs per primitive and only appends to the batch.
+        const ProfileScope scope("DefaultRenderer::flushBatch");
+        const ScopedTimer timer(m_submissionNanoseconds);
+
+        switch (m_batchPipeline)
+        {
+            case BatchPipeline::geometry:
+                flushGeometry();
+                break;
+            case BatchPipeline::instances:
+                flushInstances();
+                break;
+        }
+
+        // Drop the references so that images and shaders are not kept alive by the renderer.
+        m_batchTextures.clear();
+        m_batchState.shader.reset();
+    }
+
+    void DefaultRenderer::beginRecording(const f32 baseDepth)
+    {
+        m_recording = RecordingCapture{
+            .baseDepth = baseDepth,
+            .drawCount = 0,
+            .vertices = {},
+            .indices = {},
+            .segments = {},
+        };
+    }
+
+    std::shared_ptr<RecordedGeometry> DefaultRenderer::endRecording()
+    {
+        if (not m_recording.has_value())
+        {
+            return nullptr;
+        }
+
+        std::shared_ptr<RecordedGeometry> geometry = RecordedGeometry::create(std::move(*m_recording));
+        m_recording.reset();
+        return geometry;
+    }
+
+    bool DefaultRenderer::isRecording() const
+    {
+        return m_recording.has_value();
+    }
+
+    void DefaultRenderer::recordGeometry(const Vertices& vertices, const RenderState& renderState)
+    {
+        RecordingCapture& capture = *m_recording;
+        ++capture.drawCount;
+
+        const auto recordedPosition = [&](const Vertex& vertex)
+        {
+            const float2 position = float2{vertex.position.x, vertex.position.y};
+            return float3{renderState.transform.has_value() ? renderState.transform->transformPoint(position) : position, vertex.position.z - capture.baseDepth};
+        };
+
+        if (renderState.shader.has_value())
+        {
+            Vertices fallback = {.mode = vertices.mode, .vertices = {}, .indices = vertices.indices};
+            fallback.vertices.reserve(vertices.vertices.size());
+
+            for (const Vertex& vertex : vertices.vertices)
+            {
+                fallback.vertices.push_back(Vertex{.position = recordedPosition(vertex), .texcoord = vertex.texcoord, .color = vertex.color});
+            }
+
+            capture.segments.push_back(RecordedSegment{
+                .mode = vertices.mode,
+                .blendMode = renderState.blendMode,
+                .shader = renderState.shader,
+                .textures = renderState.image.has_value() ? std::vector<Image>{*renderState.image} : std::vector<Image>{},
+                .firstIndex = 0,
+                .indexCount = 0,
+                .fallback = std::move(fallback),
+            });
+
+            return;
+        }
+
+        const std::optional<Image> texture = getBatchTexture(renderState);
+        const auto usesTexture = [&](const Image& image)
+        {
+            return image.getResourceId() == texture->getResourceId();
+        };
+
+        RecordedSegment* segment = capture.segments.empty() ? nullptr : &capture.segments.back();
+        const bool canExtend = segment != nullptr and
+                               not segment->shader.has_value() and
+                               isListVertexMode(vertices.mode) and
+                               segment->mode == vertices.mode and
+                               segment->blendMode == renderState.blendMode and
+                               (not texture.has_value() or std::ranges::any_of(segment->textures, usesTexture) or segment->textures.size() < m_textureSlotCount);
+
+        if (not canExtend)
+        {
+            segment = &capture.segments.emplace_back(RecordedSegment{
+                .mode = vertices.mode,
+                .blendMode = renderState.blendMode,
+                .shader = std::nullopt,
+                .textures = {},
+                .firstIndex = static_cast<u32>(capture.indices.size()),
+                .indexCount = 0,
+                .fallback = {},
+            });
+        }
+
+        u32 textureSlot = UNTEXTURED_SLOT;
+        if (texture.has_value())
+        {
+            const auto slot = std::ranges::find_if(segment->textures, usesTexture);
+            if (slot == segment->textures.end())
+            {
+                segment->textures.push_back(*texture);
+            }
+
+            textureSlot = static_cast<u32>(slot == segment->textures.end() ? segment->textures.size() - 1 : std::distance(segment->textures.begin(), slot));
+        }
+
+        const u32 baseVertex = static_cast<u32>(capture.vertices.size());
+        for (const Vertex& vertex : vertices.vertices)
+        {
+            capture.vertices.push_back(BatchVertex{
+                .position = recordedPosition(vertex),
+                .texcoord = vertex.texcoord,
+                .color = vertex.color,
+                .textureSlot = textureSlot,
+                .matrixIndex = RECORDING_MATRIX_INDEX,
+            });
+        }
+
+        for (const u32 index : vertices.indices)
+        {
+            capture.indices.push_back(baseVertex + index);
+        }
+
+        segment->indexCount += static_cast<u32>(vertices.indices.size());
+    }
+
+    void DefaultRenderer::renderRecording(const RecordedGeometry& geometry, const matrix4x4& transform, const f32 depth)
+    {
+        // Segments are drawn right away, so everything submitted before has to reach the GPU first.
+        flush();
+
+        bool isTransformUploaded = false;
+
+        for (const RecordedSegment& segment : geometry.getSegments())
+        {
+            if (segment.shader.has_value())
+            {
+                Vertices vertices = segment.fallback;
+                for (Vertex& vertex : vertices.vertices)
+                {
+                    vertex.position = float3{transform.transformPoint(float2{vertex.position.x, vertex.position.y}), vertex.position.z + depth};
+                }
+
+                const RenderState renderState = {
+                    .blendMode = segment.blendMode,
+                    .shader = segment.shader,
+                    .image = segment.textures.empty() ? std::nullopt : std::optional<Image>{segment.textures.front()},
+                    .transform = std::nullopt,
+                };
+
+                commitShaderUniforms(renderState);
+                submitGeometry(vertices.mode, vertices.vertices, vertices.indices, renderState);
+                flushBatch();
+
+                // The batch may have uploaded a palette of its own over the recording transform.
+                isTransformUploaded = false;
+                continue;
+            }
+
+            const ScopedTimer timer(m_submissionNanoseconds);
+
+            if (not isTransformUploaded)
+            {
+                uploadRecordingTransform(transform, depth);
+                isTransformUploaded = true;
+            }
+
+            GLStateCache& stateCache = getStateCache();
+            stateCache.setViewport(m_framebufferSize);
+            stateCache.bindFramebuffer(m_framebufferId);
+            stateCache.setBlendMode(segment.blendMode);
+            stateCache.useProgram(m_defaultShader.getResourceId());
+
+            for (u32 slot = 0; slot < segment.textures.size(); ++slot)
+            {
+                stateCache.bindTexture(slot, segment.textures[slot].getResourceId());
+            }
+
+            stateCache.bindVertexArray(geometry.getVertexArrayId());
+            glDrawElements(vertexModeToGlId(segment.mode), static_cast<GLsizei>(segment.indexCount), GL_UNSIGNED_INT, reinterpret_cast<const void*>(segment.firstIndex * sizeof(u32)));
+            ++m_submissionStats.drawCalls;
+        }
+    }
+
+    void DefaultRenderer::uploadRecordingTransform(const matrix4x4& transform, const f32 depth)
+    {
+        AffineTransform recordingTransform = affineTransformOf(transform);
+        recordingTransform.row0.w = depth;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, m_matrixPaletteBufferId.value);
+        glBufferSubData(GL_UNIFORM_BUFFER, RECORDING_MATRIX_INDEX * sizeof(AffineTransform), sizeof(AffineTransform), &recordingTransform);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        m_submissionStats.uploadedBytes += sizeof(AffineTransform);
+    }
+
+    const FrameStats& DefaultRenderer::getFrameStats() const
+    {
+        return m_frameStats;
+    }
+
+    void DefaultRenderer::flushGeometry()
+    {
+        if (m_batchIndices.empty())
+        {
+            return;
+        }
+
+        const bool isCompact = m_batchFormat == VertexFormat::compact;
+        const usize vertexSize = isCompact ? sizeof(CompactBatchVertex) : sizeof(BatchVertex);
+        const void* vertexData = isCompact ? static_cast<const void*>(m_batchCompactVertices.data()) : static_cast<const void*>(m_batchVertices.data());
+
+        const usize vertexOffset = m_vertexStream->write(vertexData, getBatchVertexCount() * vertexSize, vertexSize);
+        const usize indexOffset = m_indexStream->write(m_batchIndices.data(), m_batchIndices.size() * sizeof(u32), sizeof(u32));
+
+        m_submissionStats.uploadedVertices += getBatchVertexCount();
+        m_submissionStats.uploadedIndices += m_batchIndices.size();
+        m_submissionStats.uploadedBytes += getBatchVertexCount() * vertexSize + m_batchIndices.size() * sizeof(u32);
+
+        // Oversized submissions make the streams reallocate, which leaves the vertex arrays pointing at deleted buffers.
+        if (m_vertexStream->getResourceId() != m_boundVertexStreamId or m_indexStream->getResourceId() != m_boundIndexStreamId)
+        {
+            setupVertexLayout(m_vertexArrayId, VertexFormat::full, m_vertexStream->getResourceId(), m_indexStream->getResourceId());
+            setupVertexLayout(m_compactPipeline.vertexArrayId, VertexFormat::compact, m_vertexStream->getResourceId(), m_indexStream->getResourceId());
+            m_boundVertexStreamId = m_vertexStream->getResourceId();
+            m_boundIndexStreamId = m_indexStream->getResourceId();
+        }
+
+        if (m_batchMatrices.size() > 1)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_matrixPaletteBufferId.value);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, m_batchMatrices.size() * sizeof(AffineTransform), m_batchMatrices.data());
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+            m_submissionStats.uploadedBytes += m_batchMatrices.size() * sizeof(AffineTransform);
+        }
+
+        bindBatchState(isCompact ? m_compactPipeline.shader.getResourceId() : shaderIdOf(m_batchState.shader, m_defaultShader));
+
+        if (m_batchState.shader.has_value())
+        {
+            applyLegacyProjection(*m_batchState.shader);
+        }
+
+        getStateCache().bindVertexArray(isCompact ? m_compactPipeline.vertexArrayId : m_vertexArrayId);
+        glDrawElementsBaseVertex(
+            vertexModeToGlId(m_batchMode),
+            static_cast<GLsizei>(m_batchIndices.size()),
+            GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(indexOffset),
+            static_cast<GLint>(vertexOffset / vertexSize)
+        );
+
+        ++m_submissionStats.drawCalls;
+
+        m_batchVertices.clear();
+        m_batchCompactVertices.clear();
+        m_batchIndices.clear();
+        m_batchMatrices.resize(1);
+    }
+
+    void DefaultRenderer::flushInstances()
+    {
+        if (m_batchInstances.empty())
+        {
+            return;
+        }
+
+        StreamBuffer& instanceStream = *m_instancePipeline.instanceStream;
+        const usize instanceOffset = instanceStream.write(m_batchInstances.data(), m_batchInstances.size() * sizeof(InstanceVertex), sizeof(InstanceVertex));
+
+        m_submissionStats.uploadedInstances += m_batchInstances.size();
+        m_submissionStats.uploadedBytes += m_batchInstances.size() * sizeof(InstanceVertex);
+
+        bindBatchState(m_instancePipeline.shader.getResourceId());
+        getStateCache().bindVertexArray(m_instancePipeline.vertexArrayId);
+
+        const auto attributeAt = [&](const usize member)
+        {
+            return reinterpret_cast<const GLvoid*>(instanceOffset + member);
+        };
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceStream.getResourceId().value);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), attributeAt(offsetof(InstanceVertex, origin)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), attributeAt(offsetof(InstanceVertex, axisX)));
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), attributeAt(offsetof(InstanceVertex, axisY)));
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), attributeAt(offsetof(InstanceVertex, depth)));
+        glVertexAttribIPointer(5, 2, GL_UNSIGNED_INT, sizeof(InstanceVertex), attributeAt(offsetof(InstanceVertex, textureSlot)));
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceVertex), attributeAt(offsetof(InstanceVertex, texRect)));
+        glVertexAttribPointer(7, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(InstanceVertex), attributeAt(offsetof(InstanceVertex, color)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(m_instancePipeline.meshIndexCount), GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(m_batchInstances.size()));
+        ++m_submissionStats.drawCalls;
+
+        m_batchInstances.clear();
+    }
+
+    void DefaultRenderer::bindBatchState(const ResourceId programId)
+    {
+        // Resource creation may have bound other framebuffers since beginDraw().
+        GLStateCache& stateCache = getStateCache();
+        stateCache.setViewport(m_framebufferSize);
+        stateCache.bindFramebuffer(m_framebufferId);
+        stateCache.setBlendMode(m_batchState.blendMode);
+        stateCache.useProgram(programId);
+
+        for (u32 slot = 0; slot < m_batchTextures.size(); ++slot)
+        {
+            stateCache.bindTexture(slot, m_batchTextures[slot].getResourceId());
+        }
+    }
+
+    std::optional<Image> DefaultRenderer::getBatchTexture(const RenderState& renderState) const
+    {
+        if (renderState.image.has_value())
+        {
+            return renderState.image;
+        }
+
+        // The default shader handles untextured vertices itself, custom shaders always sample unit 0.
+        if (renderState.shader.has_value())
+        {
+            return m_whiteImage;
+        }
+
+        return std::nullopt;
+    }
+
+    std::optional<u32> DefaultRenderer::findTextureSlot(const ResourceId textureId) const
+    {
+        for (u32 slot = 0; slot < m_batchTextures.size(); ++slot)
+        {
+            if (m_batchTextures[slot].getResourceId() == textureId)
+            {
+                return slot;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    u32 DefaultRenderer::acquireTextureSlot(const std::optional<Image>& texture)
+    {
+        if (not texture.has_value())
+        {
+            return UNTEXTURED_SLOT;
+        }
+
+        if (const std::optional<u32> slot = findTextureSlot(texture->getResourceId()))
+        {
+            return *slot;
+        }
+
+        m_batchTextures.push_back(*texture);
+        return static_cast<u32>(m_batchTextures.size() - 1);
+    }
+
+    bool DefaultRenderer::canAppendTransform(const RenderState& renderState) const
+    {
+        if (not renderState.transform.has_value() or renderState.shader.has_value())
+        {
+            return true;
+        }
+
+        return m_batchMatrices.size() < MATRIX_PALETTE_SIZE or m_batchMatrices.back() == affineTransformOf(*renderState.transform);
+    }
+
+    u32 DefaultRenderer::acquireMatrixIndex(const RenderState& renderState)
+    {
+        if (not renderState.transform.has_value() or renderState.shader.has_value())
+        {
+            return IDENTITY_MATRIX_INDEX;
+        }
+
+        // Consecutive submissions almost always share the matrix, so only the last entry is reused.
+        const AffineTransform transform = affineTransformOf(*renderState.transform);
+        if (m_batchMatrices.back() != transform)
+        {
+            m_batchMatrices.push_back(transform);
+        }
+
+        return static_cast<u32>(m_batchMatrices.size() - 1);
+    }
+
+    u32 DefaultRenderer::getTextureSlotCapacity(const RenderState& renderState) const
+    {
+        return renderState.shader.has_value() ? 1 : m_textureSlotCount;
+    }
+
+    bool DefaultRenderer::isBatchEmpty() const
+    {
+        return m_batchIndices.empty() and m_batchInstances.empty();
+    }
+
+    usize DefaultRenderer::getBatchVertexCount() const
+    {
+        return m_batchFormat == VertexFormat::compact ? m_batchCompactVertices.size() : m_batchVertices.size();
+    }
+
+    VertexFormat DefaultRenderer::getVertexFormat(const RenderState& renderState) const
+    {
+        // Custom shaders declare the full attribute layout themselves.
+        return isHintEnabled(Hint::compactVertices) and not renderState.shader.has_value() ? VertexFormat::compact : VertexFormat::full;
+    }
+
+    bool DefaultRenderer::canAppendToBatch(const VertexMode mode, const usize vertexCount, const usize indexCount, const RenderState& renderState, const std::optional<Image>& texture) const
+    {
+        if (isBatchEmpty())
+        {
+            return true;
+        }
+
+        if (getBatchVertexCount() + vertexCount > MAX_VERTICES or m_batchIndices.size() + indexCount > MAX_INDICES)
+        {
+            return false;
+        }
+
+        if (m_batchPipeline != BatchPipeline::geometry or
+            getVertexFormat(renderState) != m_batchFormat or
+            mode != m_batchMode or
+            renderState.blendMode != m_batchState.blendMode or
+            shaderIdOf(renderState.shader, m_defaultShader) != shaderIdOf(m_batchState.shader, m_defaultShader))
+        {
+            return false;
+        }
+
+        return canAppendTexture(renderState, texture) and canAppendTransform(renderState);
+    }
+
+    bool DefaultRenderer::canAppendInstance(const RenderState& renderState, const std::optional<Image>& texture) const
+    {
+        if (isBatchEmpty())
+        {
+            return true;
+        }
+
+        return m_batchPipeline == BatchPipeline::instances and
+               m_batchInstances.size() < MAX_INSTANCES and
+               renderState.blendMode == m_batchState.blendMode and
+               canAppendTexture(renderState, texture);
+    }
+
+    bool DefaultRenderer::canAppendTexture(const RenderState& renderState, const std::optional<Image>& texture) const
+    {
+        return not texture.has_value() or
+               findTextureSlot(texture->getResourceId()).has_value() or
+               m_batchTextures.size() < getTextureSlotCapacity(renderState);
+    }
+
+    void DefaultRenderer::setProjection(const matrix4x4& projection)
+    {
+        if (projection.data == m_projection.data and m_projectionRevision != 0)
+        {
+            return;
+        }
+
+        const FrameData frameData = {.projectionMatrix = projection};
+        glBindBuffer(GL_UNIFORM_BUFFER, m_frameDataBufferId.value);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &frameData);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        m_projection = projection;
+        ++m_projectionRevision;
+    }
+
+    void DefaultRenderer::applyLegacyProjection(const Shader& shader)
+    {
+        // Custom shaders may still declare the projection as a plain uniform instead of using the FrameData block.
+        const i32 location = shader.getUniformLocation(PROJECTION_MATRIX_UNIFORM);
+        if (location < 0)
+        {
+            return;
+        }
+
+        u64& revision = m_legacyProjectionRevisions[shader.getResourceId().value];
+        if (revision != m_projectionRevision)
+        {
+            glProgramUniformMatrix4fv(shader.getResourceId().value, location, 1, GL_FALSE, m_projection.data.data());
+            revision = m_projectionRevision;
+        }
+    }
+
+    DefaultRenderer::DefaultRenderer(ResourceId vertexArrayId, std::unique_ptr<StreamBuffer> vertexStream, std::unique_ptr<StreamBuffer> indexStream, ResourceId frameDataBufferId, ResourceId matrixPaletteBufferId, Image whiteImage, Shader defaultShader, CompactPipeline compactPipeline, InstancePipeline instancePipeline, const u32 textureSlotCount)
+        : m_vertexArrayId(vertexArrayId),
+          m_vertexStream(std::move(vertexStream)),
+          m_indexStream(std::move(indexStream)),
+          m_boundVertexStreamId(m_vertexStream->getResourceId()),
+          m_boundIndexStreamId(m_indexStream->getResourceId()),
+          m_frameDataBufferId(frameDataBufferId),
+          m_matrixPaletteBufferId(matrixPaletteBufferId),
+          m_whiteImage(std::move(whiteImage)),
+          m_defaultShader(std::move(defaultShader)),
+          m_compactPipeline(std::move(compactPipeline)),
+          m_instancePipeline(std::move(instancePipeline)),
+          m_textureSlotCount(textureSlotCount),
+          m_framebufferId{.value = 0},
+          m_framebufferSize(),
+          m_frameStats(),
+          m_projection(),
+          m_projectionRevision(0),
+          m_legacyProjectionRevisions(),
+          m_batchPipeline(BatchPipeline::geometry),
+          m_batchFormat(VertexFormat::full),
+          m_batchMode(VertexMode::triangles),
+          m_batchState(),
+          m_batchVertices(),
+          m_batchCompactVertices(),
+          m_batchIndices(),
+          m_batchInstances(),
+          m_batchTextures(),
+          m_batchMatrices{affineTransformOf(matrix4x4::identity)},
+          m_deferredDraws(),
+          m_deferredVertices(),
+          m_deferredIndices(),
+          m_sortEntries(),
+          m_sortScratch(),
+          m_freeOcclusionQueries(),
+          m_pendingOcclusionQueries(),
+          m_occlusionStats(),
+          m_freeTimerQueries(),
+          m_pendingTimerQueries(),
+          m_frameTimerQuery(),
+          m_passTimerQuery(),
+          m_collectedTimings(),
+          m_gpuTimerStats(),
+          m_frameIndex(0),
+          m_timedFrameIndex(0),
+          m_submissionStats(),
+          m_submissionNanoseconds(0),
+          m_recording()
+    {
+        m_batchVertices.reserve(MAX_VERTICES);
+        m_batchCompactVertices.reserve(MAX_VERTICES);
+        m_batchIndices.reserve(MAX_INDICES);
+        m_batchInstances.reserve(MAX_INSTANCES);
+    }
+} // namespace processing
+
+namespace processing
+{
+    std::shared_ptr<RecordedGeometry> RecordedGeometry::create(RecordingCapture capture)
+    {
+        // The copy target keeps the upload away from the element buffer of whatever vertex array is bound.
+        ResourceId vertexBufferId = {.value = 0};
+        glGenBuffers(1, &vertexBufferId.value);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBufferId.value);
+        glBufferData(GL_COPY_WRITE_BUFFER, capture.vertices.size() * sizeof(BatchVertex), capture.vertices.data(), GL_STATIC_DRAW);
+
+        ResourceId indexBufferId = {.value = 0};
+        glGenBuffers(1, &indexBufferId.value);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBufferId.value);
+        glBufferData(GL_COPY_WRITE_BUFFER, capture.indices.size() * sizeof(u32), capture.indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        ResourceId vertexArrayId = {.value = 0};
+        glGenVertexArrays(1, &vertexArrayId.value);
+        setupVertexLayout(vertexArrayId, VertexFormat::full, vertexBufferId, indexBufferId);
+
+        return std::shared_ptr<RecordedGeometry>(new RecordedGeometry(vertexArrayId, vertexBufferId, indexBufferId, std::move(capture.segments), capture.drawCount));
+    }
+
+    RecordedGeometry::~RecordedGeometry()
+    {
+        glDeleteVertexArrays(1, &m_vertexArrayId.value);
+        glDeleteBuffers(1, &m_vertexBufferId.value);
+        glDeleteBuffers(1, &m_indexBufferId.value);
+        getStateCache().invalidateVertexArray(m_vertexArrayId);
+    }
+
+    ResourceId RecordedGeometry::getVertexArrayId() const
+    {
+        return m_vertexArrayId;
+    }
+
+    const std::vector<RecordedSegment>& RecordedGeometry::getSegments() const
+    {
+        return m_segments;
+    }
+
+    usize RecordedGeometry::getDrawCount() const
+    {
+        return m_drawCount;
+    }
+
+    RecordedGeometry::RecordedGeometry(const ResourceId vertexArrayId, const ResourceId vertexBufferId, const ResourceId indexBufferId, std::vector<RecordedSegment> segments, const usize drawCount)
+        : m_vertexArrayId(vertexArrayId),
+          m_vertexBufferId(vertexBufferId),
+          m_indexBufferId(indexBufferId),
+          m_segments(std::move(segments)),
+          m_drawCount(drawCount)
     {
     }
 } // namespace processing
@@ -3,6 +3,11 @@
 
 #include <processing/processing.hpp>
 #include <processing/framebuffer.hpp>
+#include <processing/stream_buffer.hpp>
+
+#include <deque>
+#include <span>
+#include <unordered_map>
 
 namespace processing
 {
@@ -11,7 +16,181 @@ namespace processing
         BlendMode blendMode;
         std::optional<Shader> shader;
         std::optional<Image> image;
-        matrix4x4 transform;
+        std::optional<matrix4x4> transform;
+    };
+
+    enum class InstanceShape : u32
+    {
+        quad,
+        circle,
+    };
+
+    // An axis aligned unit shape mapped through an affine transform. The texture rectangle may
+    // have a negative height to flip the image vertically.
+    struct Instance
+    {
+        float2 origin;
+        float2 axisX;
+        float2 axisY;
+        f32 depth;
+        rect2f texRect;
+        Color color;
+    };
+
+    struct BatchVertex
+    {
+        float3 position;
+        float2 texcoord;
+        Color color;
+        u32 textureSlot;
+        u32 matrixIndex;
+    };
+
+    // Depth is a 16 bit UNORM mapped from [-1, 1], texcoords are half floats and the texture
+    // slot shares its 16 bits with the matrix index.
+    struct CompactBatchVertex
+    {
+        float2 position;
+        u16 depth;
+        u16 textureSlotAndMatrix;
+        u16 texcoord[2];
+        Color color;
+    };
+
+    static_assert(sizeof(CompactBatchVertex) == 20, "CompactBatchVertex has to stay tightly packed");
+
+    // The xy part of a 2D matrix as two std140 rows, the z column carries the translation.
+    struct AffineTransform
+    {
+        float4 row0;
+        float4 row1;
+
+        bool operator==(const AffineTransform& other) const = default;
+    };
+
+    struct InstanceVertex
+    {
+        float2 origin;
+        float2 axisX;
+        float2 axisY;
+        f32 depth;
+        u32 textureSlot;
+        u32 shape;
+        float4 texRect;
+        Color color;
+    };
+
+    enum class BatchPipeline
+    {
+        geometry,
+        instances,
+    };
+
+    enum class VertexFormat
+    {
+        full,
+        compact,
+    };
+
+    // A draw recorded while Hint::sortOpaqueDraws is enabled. Geometry refers to a range of the
+    // renderer's deferred vertex and index arrays.
+    struct DeferredDraw
+    {
+        BatchPipeline pipeline;
+        VertexMode mode;
+        u32 firstVertex;
+        u32 vertexCount;
+        u32 firstIndex;
+        u32 indexCount;
+        InstanceShape shape;
+        Instance instance;
+        RenderState state;
+        bool isOpaque;
+    };
+
+    struct DrawSortEntry
+    {
+        u64 key;
+        u32 index;
+    };
+
+    struct RecordedSegment
+    {
+        VertexMode mode;
+        BlendMode blendMode;
+        std::optional<Shader> shader;
+        std::vector<Image> textures;
+        u32 firstIndex;
+        u32 indexCount;
+
+        // Custom shaders expect world-space input, so their draws keep the vertices on the CPU
+        // and are replayed through the regular batches.
+        Vertices fallback;
+    };
+
+    struct RecordingCapture
+    {
+        f32 baseDepth;
+        usize drawCount;
+        std::vector<BatchVertex> vertices;
+        std::vector<u32> indices;
+        std::vector<RecordedSegment> segments;
+    };
+
+    // Vertices are stored with the transform baked in and the depth relative to the first draw.
+    class RecordedGeometry
+    {
+    public:
+        static std::shared_ptr<RecordedGeometry> create(RecordingCapture capture);
+
+        ~RecordedGeometry();
+
+        RecordedGeometry(const RecordedGeometry&) = delete;
+        RecordedGeometry& operator=(const RecordedGeometry&) = delete;
+
+        ResourceId getVertexArrayId() const;
+        const std::vector<RecordedSegment>& getSegments() const;
+        usize getDrawCount() const;
+
+    private:
+        explicit RecordedGeometry(ResourceId vertexArrayId, ResourceId vertexBufferId, ResourceId indexBufferId, std::vector<RecordedSegment> segments, usize drawCount);
+
+        ResourceId m_vertexArrayId;
+        ResourceId m_vertexBufferId;
+        ResourceId m_indexBufferId;
+        std::vector<RecordedSegment> m_segments;
+        usize m_drawCount;
+    };
+
+    struct PendingOcclusionQuery
+    {
+        ResourceId queryId;
+        u64 coveredFragments;
+    };
+
+    // Timestamps around a renderbuffer pass, or around the whole frame when there is no asset id.
+    struct PendingTimerQuery
+    {
+        ResourceId beginQueryId;
+        ResourceId endQueryId;
+        std::optional<AssetId> assetId;
+        u64 frameIndex;
+    };
+
+    struct CompactPipeline
+    {
+        ResourceId vertexArrayId;
+        Shader shader;
+    };
+
+    struct InstancePipeline
+    {
+        ResourceId vertexArrayId;
+        ResourceId meshBufferId;
+        ResourceId meshIndexBufferId;
+        u32 meshIndexCount;
+        std::unique_ptr<StreamBuffer> instanceStream;
+        Shader shader;
     };
 
     class DefaultRenderer
@@ -19,20 +198,124 @@ namespace processing
     public:
         static std::unique_ptr<DefaultRenderer> create();
 
-        void beginDraw(const Framebuffer& buffer);
+        void beginFrame();
+        void endFrame();
+
+        void beginDraw(const Framebuffer& buffer, AssetId assetId);
         void endDraw();
+        void blit(const Framebuffer& framebuffer, u32 width, u32 height);
 
         void render(const Vertices& vertices, const RenderState& state);
+        void renderInstance(InstanceShape shape, const Instance& instance, const RenderState& state);
+        void clear();
+        void flush();
+
+        void beginRecording(f32 baseDepth);
+        std::shared_ptr<RecordedGeometry> endRecording();
+        bool isRecording() const;
+        void renderRecording(const RecordedGeometry& geometry, const matrix4x4& transform, f32 depth);
+
+        const FrameStats& getFrameStats() const;
 
     private:
-        explicit DefaultRenderer(ResourceId vertexArrayId, ResourceId vertexBufferId, ResourceId elementBufferId, Image whiteImage, Shader defaultShader);
+        explicit DefaultRenderer(ResourceId vertexArrayId, std::unique_ptr<StreamBuffer> vertexStream, std::unique_ptr<StreamBuffer> indexStream, ResourceId frameDataBufferId, ResourceId matrixPaletteBufferId, Image whiteImage, Shader defaultShader, CompactPipeline compactPipeline, InstancePipeline instancePipeline, u32 textureSlotCount);
+
+        void submitGeometry(VertexMode mode, std::span<const Vertex> vertices, std::span<const u32> indices, const RenderState& state);
+        void submitInstance(InstanceShape shape, const Instance& instance, const RenderState& state);
+        void deferGeometry(const Vertices& vertices, const RenderState& state);
+        void deferInstance(InstanceShape shape, const Instance& instance, const RenderState& state);
+        void recordGeometry(const Vertices& vertices, const RenderState& state);
+        void uploadRecordingTransform(const matrix4x4& transform, f32 depth);
+        void submitDeferredDraws();
+        void submitDeferredDraw(const DeferredDraw& draw);
+        u64 getSortKey(const DeferredDraw& draw) const;
+        u64 estimateCoverage(const DeferredDraw& draw) const;
+        bool isDeferring() const;
+        ResourceId acquireOcclusionQuery();
+        void collectOcclusionQueries();
+        ResourceId queryTimestamp();
+        void collectTimerQueries();
+        bool isOpaqueDraw(const RenderState& state, bool hasOpaqueColors) const;
+        void commitShaderUniforms(const RenderState& state);
+        bool isShaderPending(ResourceId shaderId) const;
+
+        void flushBatch();
+        void flushGeometry();
+        void flushInstances();
+        void bindBatchState(ResourceId programId);
+
+        std::optional<Image> getBatchTexture(const RenderState& state) const;
+        std::optional<u32> findTextureSlot(ResourceId textureId) const;
+        bool isBatchEmpty() const;
+        usize getBatchVertexCount() const;
+        VertexFormat getVertexFormat(const RenderState& state) const;
+        void appendVertices(std::span<const Vertex> vertices, const RenderState& state, u32 textureSlot, u32 matrixIndex);
+        u32 acquireTextureSlot(const std::optional<Image>& texture);
+        u32 getTextureSlotCapacity(const RenderState& state) const;
+        bool canAppendToBatch(VertexMode mode, usize vertexCount, usize indexCount, const RenderState& state, const std::optional<Image>& texture) const;
+        bool canAppendInstance(const RenderState& state, const std::optional<Image>& texture) const;
+        bool canAppendTexture(const RenderState& state, const std::optional<Image>& texture) const;
+        bool canAppendTransform(const RenderState& state) const;
+        u32 acquireMatrixIndex(const RenderState& state);
+        void setProjection(const matrix4x4& projection);
+        void applyLegacyProjection(const Shader& shader);
 
         ResourceId m_vertexArrayId;
-        ResourceId m_vertexBufferId;
-        ResourceId m_elementBufferId;
+        std::unique_ptr<StreamBuffer> m_vertexStream;
+        std::unique_ptr<StreamBuffer> m_indexStream;
+        ResourceId m_boundVertexStreamId;
+        ResourceId m_boundIndexStreamId;
+        ResourceId m_frameDataBufferId;
+        ResourceId m_matrixPaletteBufferId;
 
         Image m_whiteImage;
         Shader m_defaultShader;
+        CompactPipeline m_compactPipeline;
+        InstancePipeline m_instancePipeline;
+        u32 m_textureSlotCount;
+
+        ResourceId m_framebufferId;
+        uint2 m_framebufferSize;
+        FrameStats m_frameStats;
+
+        matrix4x4 m_projection;
+        u64 m_projectionRevision;
+        std::unordered_map<u32, u64> m_legacyProjectionRevisions;
+
+        BatchPipeline m_batchPipeline;
+        VertexFormat m_batchFormat;
+        VertexMode m_batchMode;
+        RenderState m_batchState;
+        std::vector<BatchVertex> m_batchVertices;
+        std::vector<CompactBatchVertex> m_batchCompactVertices;
+        std::vector<u32> m_batchIndices;
+        std::vector<InstanceVertex> m_batchInstances;
+        std::vector<Image> m_batchTextures;
+        std::vector<AffineTransform> m_batchMatrices;
+
+        std::vector<DeferredDraw> m_deferredDraws;
+        std::vector<Vertex> m_deferredVertices;
+        std::vector<u32> m_deferredIndices;
+        std::vector<DrawSortEntry> m_sortEntries;
+        std::vector<DrawSortEntry> m_sortScratch;
+
+        std::vector<ResourceId> m_freeOcclusionQueries;
+        std::deque<PendingOcclusionQuery> m_pendingOcclusionQueries;
+        OcclusionStats m_occlusionStats;
+
+        std::vector<ResourceId> m_freeTimerQueries;
+        std::deque<PendingTimerQuery> m_pendingTimerQueries;
+        std::optional<PendingTimerQuery> m_frameTimerQuery;
+        std::optional<PendingTimerQuery> m_passTimerQuery;
+        std::vector<RenderbufferTiming> m_collectedTimings;
+        GpuTimerStats m_gpuTimerStats;
+        u64 m_frameIndex;
+        u64 m_timedFrameIndex;
+
+        SubmissionStats m_submissionStats;
+        u64 m_submissionNanoseconds;
+
+        std::optional<RecordingCapture> m_recording;
     };
 } // namespace processing
 
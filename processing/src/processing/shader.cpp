@@ -1,9 +1,12 @@
 #include <processing/shader.hpp>
+#include <processing/graphics.hpp>
+#include <processing/state_cache.hpp>
 
 #include <glad/gl.h>
 
 #include <string>
 #include <format>
+#include <unordered_map>
 
 namespace processing
 {
@@ -13,8 +16,73 @@ namespace processing
         fflush(stdout);
     }
 
+    struct UniformNameHash
+    {
+        using is_transparent = void;
+
+        usize operator()(const std::string_view name) const
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    using UniformLocations = std::unordered_map<std::string, i32, UniformNameHash, std::equal_to<>>;
+
+    struct UniformUploader
+    {
+        GLuint program;
+        GLint location;
+
+        // clang-format off
+        void operator()(const i32 value) const { glProgramUniform1i(program, location, value); }
+        void operator()(const f32 value) const { glProgramUniform1f(program, location, value); }
+        void operator()(const float2& value) const { glProgramUniform2f(program, location, value.x, value.y); }
+        void operator()(const float3& value) const { glProgramUniform3f(program, location, value.x, value.y, value.z); }
+        void operator()(const float4& value) const { glProgramUniform4f(program, location, value.x, value.y, value.z, value.w); }
+        void operator()(const matrix4x4& value) const { glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, value.data.data()); }
+        // clang-format on
+    };
+
     class OpenGLPlatformShader : public PlatformShader
     {
+    private:
+        static UniformLocations reflectUniforms(const ResourceId programId)
+        {
+            GLint uniformCount = 0;
+            GLint maxNameLength = 0;
+            glGetProgramiv(programId.value, GL_ACTIVE_UNIFORMS, &uniformCount);
+            glGetProgramiv(programId.value, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+            UniformLocations locations;
+            std::string buffer(maxNameLength, '\0');
+
+            for (GLint i = 0; i < uniformCount; ++i)
+            {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = GL_NONE;
+                glGetActiveUniform(programId.value, i, buffer.size(), &length, &size, &type, buffer.data());
+
+                std::string name = buffer.substr(0, length);
+                const GLint location = glGetUniformLocation(programId.value, name.c_str());
+
+                // Members of uniform blocks have no location and are fed through buffers instead.
+                if (location < 0)
+                {
+                    continue;
+                }
+
+                if (name.ends_with("[0]"))
+                {
+                    locations.emplace(name.substr(0, name.size() - 3), location);
+                }
+
+                locations.emplace(std::move(name), location);
+            }
+
+            return locations;
+        }
+
     public:
         static std::unique_ptr<OpenGLPlatformShader> create(const std::string_view vertexShaderSource, const std::string_view fragmentShaderSource)
         {
@@ -64,12 +132,40 @@ namespace processing
             glDeleteShader(vsShader.value);
             glDeleteShader(fsShader.value);
 
-            return std::unique_ptr<OpenGLPlatformShader>(new OpenGLPlatformShader(shaderProgramId));
+            {
+                GLint success = GL_FALSE;
+                glGetProgramiv(shaderProgramId.value, GL_LINK_STATUS, &success);
+                if (success == GL_FALSE)
+                {
+                    GLint length = 0;
+                    glGetProgramiv(shaderProgramId.value, GL_INFO_LOG_LENGTH, &length);
+                    std::string buffer(length, '\0');
+                    glGetProgramInfoLog(shaderProgramId.value, buffer.size(), &length, buffer.data());
+                    log(std::format("Failed to link shader program: {}", buffer));
+                }
+            }
+
+            const GLuint frameDataIndex = glGetUniformBlockIndex(shaderProgramId.value, FRAME_DATA_BLOCK.data());
+            if (frameDataIndex != GL_INVALID_INDEX)
+            {
+                glUniformBlockBinding(shaderProgramId.value, frameDataIndex, FRAME_DATA_BINDING);
+            }
+
+            UniformLocations uniformLocations = reflectUniforms(shaderProgramId);
+
+            // The renderer always binds the image to the first texture unit.
+            if (const auto it = uniformLocations.find(TEXTURE_SAMPLER_UNIFORM); it != uniformLocations.end())
+            {
+                glProgramUniform1i(shaderProgramId.value, it->second, 0);
+            }
+
+            return std::unique_ptr<OpenGLPlatformShader>(new OpenGLPlatformShader(shaderProgramId, std::move(uniformLocations)));
         }
 
         ~OpenGLPlatformShader() override
         {
             glDeleteProgram(m_shaderProgramId.value);
+            getStateCache().invalidateProgram(m_shaderProgramId);
         }
 
         ResourceId getResourceId() const override
@@ -77,13 +173,62 @@ namespace processing
             return m_shaderProgramId;
         }
 
+        i32 getUniformLocation(const std::string_view name) const override
+        {
+            if (const auto it = m_uniformLocations.find(name); it != m_uniformLocations.end())
+            {
+                return it->second;
+            }
+
+            return -1;
+        }
+
+        void setUniform(const i32 location, const UniformValue& value) override
+        {
+            if (location < 0)
+            {
+                return;
+            }
+
+            // Only the most recent value per location is uploaded once the shader is used again.
+            for (auto& [pendingLocation, pendingValue] : m_pendingUniforms)
+            {
+                if (pendingLocation == location)
+                {
+                    pendingValue = value;
+                    return;
+                }
+            }
+
+            m_pendingUniforms.emplace_back(location, value);
+        }
+
+        bool hasPendingUniforms() const override
+        {
+            return not m_pendingUniforms.empty();
+        }
+
+        void commitUniforms() override
+        {
+            for (const auto& [location, value] : m_pendingUniforms)
+            {
+                std::visit(UniformUploader{.program = m_shaderProgramId.value, .location = location}, value);
+            }
+
+            m_pendingUniforms.clear();
+        }
+
     private:
-        explicit OpenGLPlatformShader(const ResourceId shaderProgramId)
-            : m_shaderProgramId(shaderProgramId)
+        explicit OpenGLPlatformShader(const ResourceId shaderProgramId, UniformLocations uniformLocations)
+            : m_shaderProgramId(shaderProgramId),
+              m_uniformLocations(std::move(uniformLocations)),
+              m_pendingUniforms()
         {
         }
 
         ResourceId m_shaderProgramId;
+        UniformLocations m_uniformLocations;
+        std::vector<std::pair<i32, UniformValue>> m_pendingUniforms;
     };
 } // namespace processing
 
@@ -91,6 +236,7 @@ namespace processing
 {
     Shader ShaderAssetHandler::create(std::string_view vertexShaderSource, std::string_view fragmentShaderSource)
     {
+        const ProfileScope scope("createShader");
         if (auto image = OpenGLPlatformShader::create(vertexShaderSource, fragmentShaderSource))
         {
             std::shared_ptr<PlatformShader>& ptr = m_assets.emplace_back(std::move(image));
@@ -111,6 +257,62 @@ namespace processing
     {
     }
 
+    void Shader::setUniform(const std::string_view name, const i32 value)
+    {
+        setUniformAt(m_impl->getUniformLocation(name), value);
+    }
+
+    void Shader::setUniform(const std::string_view name, const f32 value)
+    {
+        setUniformAt(m_impl->getUniformLocation(name), value);
+    }
+
+    void Shader::setUniform(const std::string_view name, const float2& value)
+    {
+        setUniformAt(m_impl->getUniformLocation(name), value);
+    }
+
+    void Shader::setUniform(const std::string_view name, const float3& value)
+    {
+        setUniformAt(m_impl->getUniformLocation(name), value);
+    }
+
+    void Shader::setUniform(const std::string_view name, const float4& value)
+    {
+        setUniformAt(m_impl->getUniformLocation(name), value);
+    }
+
+    void Shader::setUniform(const std::string_view name, const matrix4x4& value)
+    {
+        setUniformAt(m_impl->getUniformLocation(name), value);
+    }
+
+    void Shader::setUniformAt(const i32 location, const UniformValue& value)
+    {
+        // The pending uniforms belong to the main thread, a pipelined frame records the change instead.
+        if (CommandEncoder* encoder = getFrameEncoder())
+        {
+            return encoder->setUniform(*this, location, value);
+        }
+
+        m_impl->setUniform(location, value);
+    }
+
+    i32 Shader::getUniformLocation(const std::string_view name) const
+    {
+        return m_impl->getUniformLocation(name);
+    }
+
+    bool Shader::hasPendingUniforms() const
+    {
+        return m_impl->hasPendingUniforms();
+    }
+
+    void Shader::commitUniforms()
+    {
+        m_impl->commitUniforms();
+    }
+
     ResourceId Shader::getResourceId() const
     {
         return m_impl->getResourceId();
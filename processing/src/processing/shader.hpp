@@ -3,6 +3,14 @@
 
 #include <processing/processing.hpp>
 
+namespace processing
+{
+    inline static constexpr u32 FRAME_DATA_BINDING = 0;
+    inline static constexpr std::string_view FRAME_DATA_BLOCK = "FrameData";
+    inline static constexpr std::string_view TEXTURE_SAMPLER_UNIFORM = "u_TextureSampler";
+    inline static constexpr std::string_view PROJECTION_MATRIX_UNIFORM = "u_ProjectionMatrix";
+} // namespace processing
+
 namespace processing
 {
     class ShaderAssetHandler
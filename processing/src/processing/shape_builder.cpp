@@ -717,3 +717,44 @@ namespace processing
         return contour;
     }
 } // namespace processing
+
+namespace processing
+{
+    Vertices vertices_from_contour(const Contour& contour, const matrix4x4& transform, Color color, float depth)
+    {
+        Vertices shape;
+        shape.mode = VertexMode::triangles;
+        shape.vertices.reserve(contour.positions.size());
+        shape.indices.append_range(contour.indices);
+
+        for (size_t i = 0; i < contour.positions.size(); ++i)
+        {
+            shape.vertices.push_back(Vertex{
+                .position = float3{transform.transformPoint(contour.positions[i]), depth},
+                .texcoord = contour.texcoords[i],
+                .color = color,
+            });
+        }
+
+        return shape;
+    }
+
+    Vertices vertices_from_contour(const Contour& contour, Color color, float depth)
+    {
+        Vertices shape;
+        shape.mode = VertexMode::triangles;
+        shape.vertices.reserve(contour.positions.size());
+        shape.indices.append_range(contour.indices);
+
+        for (size_t i = 0; i < contour.positions.size(); ++i)
+        {
+            shape.vertices.push_back(Vertex{
+                .position = float3{contour.positions[i], depth},
+                .texcoord = contour.texcoords[i],
+                .color = color,
+            });
+        }
+
+        return shape;
+    }
+} // namespace processing
@@ -128,4 +128,10 @@ namespace processing
     Contour contour_image(float left, float top, float width, float height, float sourceLeft, float sourceTop, float sourceWidth, float sourceHeight);
 } // namespace processing
 
+namespace processing
+{
+    Vertices vertices_from_contour(const Contour& contour, const matrix4x4& transform, Color color, float depth);
+    Vertices vertices_from_contour(const Contour& contour, Color color, float depth);
+} // namespace processing
+
 #endif // _PROCESSING_INCLUDE_SHAPE_BUILDER_HPP_
@@ -0,0 +1,116 @@
+#include <processing/skyline_packer.hpp>
+
+#include <limits>
+
+namespace processing
+{
+    SkylinePacker::SkylinePacker(const uint2& size)
+        : m_size(size),
+          m_skyline{Segment{.x = 0, .y = 0, .width = size.x}}
+    {
+    }
+
+    std::optional<uint2> SkylinePacker::pack(const uint2& size)
+    {
+        std::optional<usize> bestIndex;
+        uint2 bestPosition;
+        u32 bestBottom = std::numeric_limits<u32>::max();
+        u32 bestWidth = std::numeric_limits<u32>::max();
+
+        // Bottom-left heuristic: lowest resulting top edge first, narrowest segment second.
+        for (usize i = 0; i < m_skyline.size(); ++i)
+        {
+            if (const std::optional<u32> y = fit(i, size))
+            {
+                const u32 bottom = *y + size.y;
+                if (bottom < bestBottom or (bottom == bestBottom and m_skyline[i].width < bestWidth))
+                {
+                    bestIndex = i;
+                    bestPosition = uint2{m_skyline[i].x, *y};
+                    bestBottom = bottom;
+                    bestWidth = m_skyline[i].width;
+                }
+            }
+        }
+
+        if (not bestIndex.has_value())
+        {
+            return std::nullopt;
+        }
+
+        insert(*bestIndex, bestPosition, size);
+        return bestPosition;
+    }
+
+    std::optional<u32> SkylinePacker::fit(usize index, const uint2& size) const
+    {
+        const u32 x = m_skyline[index].x;
+        if (x + size.x > m_size.x)
+        {
+            return std::nullopt;
+        }
+
+        u32 y = m_skyline[index].y;
+        i64 widthLeft = size.x;
+
+        while (widthLeft > 0)
+        {
+            if (index >= m_skyline.size())
+            {
+                return std::nullopt;
+            }
+
+            y = std::max(y, m_skyline[index].y);
+            if (y + size.y > m_size.y)
+            {
+                return std::nullopt;
+            }
+
+            widthLeft -= m_skyline[index].width;
+            ++index;
+        }
+
+        return y;
+    }
+
+    void SkylinePacker::insert(const usize index, const uint2& position, const uint2& size)
+    {
+        m_skyline.insert(m_skyline.begin() + index, Segment{.x = position.x, .y = position.y + size.y, .width = size.x});
+
+        // Cut away the parts of the following segments that are now covered by the new one.
+        for (usize i = index + 1; i < m_skyline.size();)
+        {
+            const Segment& previous = m_skyline[i - 1];
+            const u32 previousRight = previous.x + previous.width;
+            Segment& current = m_skyline[i];
+
+            if (current.x >= previousRight)
+            {
+                break;
+            }
+
+            const u32 shrink = previousRight - current.x;
+            if (current.width <= shrink)
+            {
+                m_skyline.erase(m_skyline.begin() + i);
+                continue;
+            }
+
+            current.x += shrink;
+            current.width -= shrink;
+            break;
+        }
+
+        for (usize i = 0; i + 1 < m_skyline.size();)
+        {
+            if (m_skyline[i].y == m_skyline[i + 1].y)
+            {
+                m_skyline[i].width += m_skyline[i + 1].width;
+                m_skyline.erase(m_skyline.begin() + i + 1);
+                continue;
+            }
+
+            ++i;
+        }
+    }
+} // namespace processing
@@ -0,0 +1,31 @@
+#ifndef _PROCESSING_INCLUDE_SKYLINE_PACKER_HPP_
+#define _PROCESSING_INCLUDE_SKYLINE_PACKER_HPP_
+
+#include <processing/processing.hpp>
+
+namespace processing
+{
+    class SkylinePacker
+    {
+    public:
+        explicit SkylinePacker(const uint2& size);
+
+        std::optional<uint2> pack(const uint2& size);
+
+    private:
+        struct Segment
+        {
+            u32 x;
+            u32 y;
+            u32 width;
+        };
+
+        std::optional<u32> fit(usize index, const uint2& size) const;
+        void insert(usize index, const uint2& position, const uint2& size);
+
+        uint2 m_size;
+        std::vector<Segment> m_skyline;
+    };
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_SKYLINE_PACKER_HPP_
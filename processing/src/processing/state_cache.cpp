@@ -0,0 +1,292 @@
+#include <processing/state_cache.hpp>
+
+#include <glad/gl.h>
+
+namespace processing
+{
+    inline static void activate(const BlendMode mode)
+    {
+        switch (mode)
+        {
+            case BlendMode::opaque:
+            {
+                glDisable(GL_BLEND);
+                return;
+            }
+
+            case BlendMode::alpha:
+            {
+                glEnable(GL_BLEND);
+                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+                glBlendFuncSeparate(
+                    GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, // RGB
+                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA        // Alpha
+                );
+                break;
+            }
+
+            case BlendMode::premultiplied:
+            {
+                glEnable(GL_BLEND);
+                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+                glBlendFuncSeparate(
+                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA, // RGB
+                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA  // Alpha
+                );
+                break;
+            }
+
+            case BlendMode::additive:
+            {
+                glEnable(GL_BLEND);
+                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+                glBlendFuncSeparate(
+                    GL_SRC_ALPHA, GL_ONE, // RGB
+                    GL_ONE, GL_ONE        // Alpha
+                );
+                break;
+            }
+
+            case BlendMode::multiply:
+            {
+                glEnable(GL_BLEND);
+                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+                glBlendFuncSeparate(
+                    GL_DST_COLOR, GL_ZERO, // RGB
+                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+                );
+                break;
+            }
+
+            case BlendMode::screen:
+            {
+                glEnable(GL_BLEND);
+                glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+                glBlendFuncSeparate(
+                    GL_ONE, GL_ONE_MINUS_SRC_COLOR, // RGB
+                    GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+                );
+                break;
+            }
+
+            case BlendMode::subtract:
+            {
+                glEnable(GL_BLEND);
+                glBlendEquationSeparate(GL_FUNC_REVERSE_SUBTRACT, GL_FUNC_ADD);
+                glBlendFuncSeparate(
+                    GL_SRC_ALPHA, GL_ONE, // RGB
+                    GL_ONE, GL_ONE
+                );
+                break;
+            }
+        }
+    }
+} // namespace processing
+
+namespace processing
+{
+    inline static void count(StateChangeStats& stats, const bool issued)
+    {
+        if (issued)
+        {
+            ++stats.issued;
+        }
+        else
+        {
+            ++stats.skipped;
+        }
+    }
+
+    GLStateCache::GLStateCache()
+        : m_program(),
+          m_activeTextureUnit(),
+          m_textures(),
+          m_vertexArray(),
+          m_drawFramebuffer(),
+          m_readFramebuffer(),
+          m_blendMode(),
+          m_viewport(),
+          m_statistics()
+    {
+    }
+
+    void GLStateCache::reset()
+    {
+        m_program.reset();
+        m_activeTextureUnit.reset();
+        m_textures.fill(std::nullopt);
+        m_vertexArray.reset();
+        m_drawFramebuffer.reset();
+        m_readFramebuffer.reset();
+        m_blendMode.reset();
+        m_viewport.reset();
+    }
+
+    void GLStateCache::useProgram(const ResourceId programId)
+    {
+        const bool issued = m_program != programId;
+        if (issued)
+        {
+            glUseProgram(programId.value);
+            m_program = programId;
+        }
+
+        count(m_statistics.programBinds, issued);
+    }
+
+    void GLStateCache::bindTexture(const u32 unit, const ResourceId textureId)
+    {
+        const bool issued = m_textures[unit] != textureId;
+        if (issued)
+        {
+            activeTexture(unit);
+            glBindTexture(GL_TEXTURE_2D, textureId.value);
+            m_textures[unit] = textureId;
+        }
+
+        count(m_statistics.textureBinds, issued);
+    }
+
+    void GLStateCache::bindVertexArray(const ResourceId vertexArrayId)
+    {
+        const bool issued = m_vertexArray != vertexArrayId;
+        if (issued)
+        {
+            glBindVertexArray(vertexArrayId.value);
+            m_vertexArray = vertexArrayId;
+        }
+
+        count(m_statistics.vertexArrayBinds, issued);
+    }
+
+    void GLStateCache::bindFramebuffer(const ResourceId framebufferId)
+    {
+        const bool issued = m_drawFramebuffer != framebufferId or m_readFramebuffer != framebufferId;
+        if (issued)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebufferId.value);
+            m_drawFramebuffer = framebufferId;
+            m_readFramebuffer = framebufferId;
+        }
+
+        count(m_statistics.framebufferBinds, issued);
+    }
+
+    void GLStateCache::bindDrawFramebuffer(const ResourceId framebufferId)
+    {
+        const bool issued = m_drawFramebuffer != framebufferId;
+        if (issued)
+        {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebufferId.value);
+            m_drawFramebuffer = framebufferId;
+        }
+
+        count(m_statistics.framebufferBinds, issued);
+    }
+
+    void GLStateCache::bindReadFramebuffer(const ResourceId framebufferId)
+    {
+        const bool issued = m_readFramebuffer != framebufferId;
+        if (issued)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebufferId.value);
+            m_readFramebuffer = framebufferId;
+        }
+
+        count(m_statistics.framebufferBinds, issued);
+    }
+
+    void GLStateCache::setBlendMode(const BlendMode mode)
+    {
+        const bool issued = m_blendMode != mode;
+        if (issued)
+        {
+            activate(mode);
+            m_blendMode = mode;
+        }
+
+        count(m_statistics.blendChanges, issued);
+    }
+
+    void GLStateCache::setViewport(const uint2& size)
+    {
+        const bool issued = m_viewport != size;
+        if (issued)
+        {
+            glViewport(0, 0, size.x, size.y);
+            m_viewport = size;
+        }
+
+        count(m_statistics.viewportChanges, issued);
+    }
+
+    void GLStateCache::invalidateProgram(const ResourceId programId)
+    {
+        if (m_program == programId)
+        {
+            m_program.reset();
+        }
+    }
+
+    void GLStateCache::invalidateTexture(const ResourceId textureId)
+    {
+        // Deleting a texture unbinds it from every unit, so the names must not be trusted anymore.
+        for (std::optional<ResourceId>& texture : m_textures)
+        {
+            if (texture == textureId)
+            {
+                texture.reset();
+            }
+        }
+    }
+
+    void GLStateCache::invalidateVertexArray(const ResourceId vertexArrayId)
+    {
+        if (m_vertexArray == vertexArrayId)
+        {
+            m_vertexArray.reset();
+        }
+    }
+
+    void GLStateCache::invalidateFramebuffer(const ResourceId framebufferId)
+    {
+        if (m_drawFramebuffer == framebufferId)
+        {
+            m_drawFramebuffer.reset();
+        }
+
+        if (m_readFramebuffer == framebufferId)
+        {
+            m_readFramebuffer.reset();
+        }
+    }
+
+    void GLStateCache::resetStatistics()
+    {
+        m_statistics = {};
+    }
+
+    const FrameStats& GLStateCache::getStatistics() const
+    {
+        return m_statistics;
+    }
+
+    void GLStateCache::activeTexture(const u32 unit)
+    {
+        if (m_activeTextureUnit != unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            m_activeTextureUnit = unit;
+        }
+    }
+} // namespace processing
+
+namespace processing
+{
+    inline static GLStateCache s_stateCache;
+
+    GLStateCache& getStateCache()
+    {
+        return s_stateCache;
+    }
+} // namespace processing
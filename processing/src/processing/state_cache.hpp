@@ -0,0 +1,52 @@
+#ifndef _PROCESSING_INCLUDE_STATE_CACHE_HPP_
+#define _PROCESSING_INCLUDE_STATE_CACHE_HPP_
+
+#include <processing/processing.hpp>
+
+namespace processing
+{
+    class GLStateCache
+    {
+    public:
+        inline static constexpr u32 MAX_TEXTURE_UNITS = 32;
+
+        GLStateCache();
+
+        void reset();
+
+        void useProgram(ResourceId programId);
+        void bindTexture(u32 unit, ResourceId textureId);
+        void bindVertexArray(ResourceId vertexArrayId);
+        void bindFramebuffer(ResourceId framebufferId);
+        void bindDrawFramebuffer(ResourceId framebufferId);
+        void bindReadFramebuffer(ResourceId framebufferId);
+        void setBlendMode(BlendMode mode);
+        void setViewport(const uint2& size);
+
+        void invalidateProgram(ResourceId programId);
+        void invalidateTexture(ResourceId textureId);
+        void invalidateVertexArray(ResourceId vertexArrayId);
+        void invalidateFramebuffer(ResourceId framebufferId);
+
+        void resetStatistics();
+        const FrameStats& getStatistics() const;
+
+    private:
+        void activeTexture(u32 unit);
+
+        std::optional<ResourceId> m_program;
+        std::optional<u32> m_activeTextureUnit;
+        std::array<std::optional<ResourceId>, MAX_TEXTURE_UNITS> m_textures;
+        std::optional<ResourceId> m_vertexArray;
+        std::optional<ResourceId> m_drawFramebuffer;
+        std::optional<ResourceId> m_readFramebuffer;
+        std::optional<BlendMode> m_blendMode;
+        std::optional<uint2> m_viewport;
+
+        FrameStats m_statistics;
+    };
+
+    GLStateCache& getStateCache();
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_STATE_CACHE_HPP_
@@ -0,0 +1,258 @@
+#include <processing/stream_buffer.hpp>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace processing
+{
+    inline static constexpr usize STREAM_BUFFER_REGIONS = 3;
+    inline static constexpr GLbitfield PERSISTENT_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    using PFNGLBUFFERSTORAGE = void (*)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+    inline static PFNGLBUFFERSTORAGE s_glBufferStorage = nullptr;
+
+    inline static bool isBufferStorageSupported()
+    {
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+        if (major > 4 or (major == 4 and minor >= 4))
+        {
+            return true;
+        }
+
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+        for (GLint i = 0; i < extensionCount; ++i)
+        {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension != nullptr and std::string_view{extension} == "GL_ARB_buffer_storage")
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void loadStreamBufferFunctions(const GLProcLoader loader)
+    {
+        s_glBufferStorage = nullptr;
+
+        if (isBufferStorageSupported())
+        {
+            s_glBufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGE>(loader("glBufferStorage"));
+        }
+    }
+
+    inline static constexpr usize alignUp(const usize value, const usize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+} // namespace processing
+
+namespace processing
+{
+    std::unique_ptr<StreamBuffer> StreamBuffer::create(const usize regionCapacity)
+    {
+        return std::unique_ptr<StreamBuffer>(new StreamBuffer(allocate(regionCapacity)));
+    }
+
+    StreamBuffer::~StreamBuffer()
+    {
+        release();
+    }
+
+    usize StreamBuffer::write(const void* data, const usize size, const usize alignment)
+    {
+        m_highWaterMark = std::max(m_highWaterMark, size);
+
+        if (size + alignment > m_regionCapacity)
+        {
+            grow(size + alignment);
+        }
+
+        const usize offset = reserve(size, alignment);
+
+        if (m_mappedMemory != nullptr)
+        {
+            std::memcpy(m_mappedMemory + offset, data, size);
+        }
+        else
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferId.value);
+            void* memory = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            std::memcpy(memory, data, size);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        return offset;
+    }
+
+    ResourceId StreamBuffer::getResourceId() const
+    {
+        return m_bufferId;
+    }
+
+    bool StreamBuffer::isPersistent() const
+    {
+        return m_mappedMemory != nullptr;
+    }
+
+    StreamBufferStats StreamBuffer::getStatistics() const
+    {
+        return StreamBufferStats{
+            .capacity = m_regionCapacity,
+            .highWaterMark = m_highWaterMark,
+            .growCount = m_growCount,
+        };
+    }
+
+    StreamBuffer::Storage StreamBuffer::allocate(const usize regionCapacity)
+    {
+        const usize capacity = regionCapacity * STREAM_BUFFER_REGIONS;
+
+        ResourceId bufferId = {.value = 0};
+        glGenBuffers(1, &bufferId.value);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bufferId.value);
+
+        if (s_glBufferStorage != nullptr)
+        {
+            s_glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr, PERSISTENT_MAP_FLAGS);
+            void* mappedMemory = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, PERSISTENT_MAP_FLAGS);
+
+            if (mappedMemory != nullptr)
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+                return Storage{.bufferId = bufferId, .regionCapacity = regionCapacity, .regionCount = STREAM_BUFFER_REGIONS, .mappedMemory = static_cast<u8*>(mappedMemory)};
+            }
+
+            // Immutable storage cannot be respecified, start over with a mutable buffer.
+            glDeleteBuffers(1, &bufferId.value);
+            glGenBuffers(1, &bufferId.value);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, bufferId.value);
+        }
+
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        return Storage{.bufferId = bufferId, .regionCapacity = capacity, .regionCount = 1, .mappedMemory = nullptr};
+    }
+
+    StreamBuffer::StreamBuffer(const Storage& storage)
+        : m_bufferId(storage.bufferId),
+          m_regionCapacity(storage.regionCapacity),
+          m_regionCount(storage.regionCount),
+          m_region(0),
+          m_cursor(0),
+          m_mappedMemory(storage.mappedMemory),
+          m_fences(storage.regionCount, nullptr),
+          m_highWaterMark(0),
+          m_growCount(0)
+    {
+    }
+
+    void StreamBuffer::release()
+    {
+        for (void* fence : m_fences)
+        {
+            if (fence != nullptr)
+            {
+                glDeleteSync(static_cast<GLsync>(fence));
+            }
+        }
+
+        if (m_mappedMemory != nullptr)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferId.value);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+
+        // The driver keeps the storage alive for draws that are still in flight.
+        glDeleteBuffers(1, &m_bufferId.value);
+    }
+
+    void StreamBuffer::grow(const usize requiredSize)
+    {
+        // The fallback keeps all regions in one, so grow per logical region in both modes.
+        const usize logicalRegionCapacity = m_regionCapacity * m_regionCount / STREAM_BUFFER_REGIONS;
+
+        usize regionCapacity = std::max<usize>(logicalRegionCapacity, 1);
+        do
+        {
+            regionCapacity *= 2;
+        } while (regionCapacity < requiredSize);
+
+        release();
+
+        const Storage storage = allocate(regionCapacity);
+        m_bufferId = storage.bufferId;
+        m_regionCapacity = storage.regionCapacity;
+        m_regionCount = storage.regionCount;
+        m_region = 0;
+        m_cursor = 0;
+        m_mappedMemory = storage.mappedMemory;
+        m_fences.assign(storage.regionCount, nullptr);
+
+        ++m_growCount;
+    }
+
+    usize StreamBuffer::reserve(const usize size, const usize alignment)
+    {
+        const usize regionEnd = (m_region + 1) * m_regionCapacity;
+        usize offset = alignUp(m_cursor, alignment);
+
+        if (offset + size > regionEnd)
+        {
+            enterRegion((m_region + 1) % m_regionCount);
+            offset = alignUp(m_cursor, alignment);
+        }
+
+        m_cursor = offset + size;
+        return offset;
+    }
+
+    void StreamBuffer::enterRegion(const usize region)
+    {
+        if (m_mappedMemory == nullptr)
+        {
+            // Orphaning hands the old storage to the driver, which keeps it alive for in-flight draws.
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferId.value);
+            glBufferData(GL_COPY_WRITE_BUFFER, m_regionCapacity * m_regionCount, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        else
+        {
+            m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+            if (GLsync fence = static_cast<GLsync>(m_fences[region]))
+            {
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000) == GL_TIMEOUT_EXPIRED)
+                {
+                }
+
+                glDeleteSync(fence);
+                m_fences[region] = nullptr;
+            }
+        }
+
+        m_region = region;
+        m_cursor = region * m_regionCapacity;
+    }
+} // namespace processing
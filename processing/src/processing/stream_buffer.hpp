@@ -0,0 +1,61 @@
+#ifndef _PROCESSING_INCLUDE_STREAM_BUFFER_HPP_
+#define _PROCESSING_INCLUDE_STREAM_BUFFER_HPP_
+
+#include <processing/processing.hpp>
+
+namespace processing
+{
+    using GLProc = void (*)();
+    using GLProcLoader = GLProc (*)(const char* name);
+
+    void loadStreamBufferFunctions(GLProcLoader loader);
+
+    // Ring of fenced, persistently mapped regions (GL 4.4 / ARB_buffer_storage).
+    // Falls back to orphaning + unsynchronized maps on plain 4.1 contexts.
+    // Writes larger than a region reallocate the buffer with geometrically grown regions,
+    // which changes its resource id.
+    class StreamBuffer
+    {
+    public:
+        static std::unique_ptr<StreamBuffer> create(usize regionCapacity);
+
+        ~StreamBuffer();
+
+        usize write(const void* data, usize size, usize alignment);
+
+        ResourceId getResourceId() const;
+        bool isPersistent() const;
+        StreamBufferStats getStatistics() const;
+
+    private:
+        struct Storage
+        {
+            ResourceId bufferId;
+            usize regionCapacity;
+            usize regionCount;
+            u8* mappedMemory;
+        };
+
+        static Storage allocate(usize regionCapacity);
+
+        explicit StreamBuffer(const Storage& storage);
+
+        void release();
+        void grow(usize requiredSize);
+        usize reserve(usize size, usize alignment);
+        void enterRegion(usize region);
+
+        ResourceId m_bufferId;
+        usize m_regionCapacity;
+        usize m_regionCount;
+        usize m_region;
+        usize m_cursor;
+        u8* m_mappedMemory;
+        std::vector<void*> m_fences;
+
+        usize m_highWaterMark;
+        u64 m_growCount;
+    };
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_STREAM_BUFFER_HPP_
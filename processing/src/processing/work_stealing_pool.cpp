@@ -0,0 +1,149 @@
+#include <processing/work_stealing_pool.hpp>
+
+#include <algorithm>
+
+namespace processing
+{
+    std::unique_ptr<WorkStealingPool> WorkStealingPool::create(const u32 workerCount)
+    {
+        return std::unique_ptr<WorkStealingPool>(new WorkStealingPool(std::max(workerCount, 1u)));
+    }
+
+    WorkStealingPool::~WorkStealingPool()
+    {
+        wait();
+
+        {
+            const std::lock_guard lock(m_signalMutex);
+            m_isStopping = true;
+        }
+
+        m_jobAvailable.notify_all();
+
+        for (std::thread& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    void WorkStealingPool::submit(Job job)
+    {
+        const u32 queueIndex = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        ++m_pendingJobs;
+
+        {
+            WorkerQueue& queue = *m_queues[queueIndex];
+            const std::lock_guard lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+
+        // Counting under the signal mutex keeps a worker from missing the wake-up between its last look and its wait.
+        {
+            const std::lock_guard lock(m_signalMutex);
+            ++m_queuedJobs;
+        }
+
+        m_jobAvailable.notify_one();
+    }
+
+    void WorkStealingPool::wait()
+    {
+        while (std::optional<Job> job = take(0))
+        {
+            (*job)();
+            finish();
+        }
+
+        std::unique_lock lock(m_signalMutex);
+        m_jobsDone.wait(lock, [this] { return m_pendingJobs == 0; });
+    }
+
+    u32 WorkStealingPool::getWorkerCount() const
+    {
+        return static_cast<u32>(m_workers.size());
+    }
+
+    WorkStealingPool::WorkStealingPool(const u32 workerCount)
+        : m_queues(),
+          m_workers(),
+          m_signalMutex(),
+          m_jobAvailable(),
+          m_jobsDone(),
+          m_queuedJobs(0),
+          m_pendingJobs(0),
+          m_nextQueue(0),
+          m_isStopping(false)
+    {
+        for (u32 index = 0; index < workerCount; ++index)
+        {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+
+        for (u32 index = 0; index < workerCount; ++index)
+        {
+            m_workers.emplace_back(&WorkStealingPool::run, this, index);
+        }
+    }
+
+    void WorkStealingPool::run(const u32 workerIndex)
+    {
+        while (true)
+        {
+            if (std::optional<Job> job = take(workerIndex))
+            {
+                (*job)();
+                finish();
+                continue;
+            }
+
+            std::unique_lock lock(m_signalMutex);
+            m_jobAvailable.wait(lock, [this] { return m_isStopping or m_queuedJobs > 0; });
+
+            if (m_isStopping and m_queuedJobs == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    std::optional<WorkStealingPool::Job> WorkStealingPool::take(const u32 workerIndex)
+    {
+        {
+            WorkerQueue& own = *m_queues[workerIndex];
+            const std::lock_guard lock(own.mutex);
+
+            if (not own.jobs.empty())
+            {
+                Job job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                --m_queuedJobs;
+                return job;
+            }
+        }
+
+        for (usize offset = 1; offset < m_queues.size(); ++offset)
+        {
+            WorkerQueue& victim = *m_queues[(workerIndex + offset) % m_queues.size()];
+            const std::lock_guard lock(victim.mutex);
+
+            if (not victim.jobs.empty())
+            {
+                Job job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                --m_queuedJobs;
+                return job;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    void WorkStealingPool::finish()
+    {
+        if (m_pendingJobs.fetch_sub(1) == 1)
+        {
+            const std::lock_guard lock(m_signalMutex);
+            m_jobsDone.notify_all();
+        }
+    }
+} // namespace processing
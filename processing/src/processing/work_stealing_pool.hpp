@@ -0,0 +1,58 @@
+#ifndef _PROCESSING_INCLUDE_WORK_STEALING_POOL_HPP_
+#define _PROCESSING_INCLUDE_WORK_STEALING_POOL_HPP_
+
+#include <processing/processing.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace processing
+{
+    // Every worker owns a queue and takes its newest job first. Idle workers steal the oldest
+    // job of another queue, and wait() lets the submitting thread help until all jobs are done.
+    class WorkStealingPool
+    {
+    public:
+        using Job = std::function<void()>;
+
+        static std::unique_ptr<WorkStealingPool> create(u32 workerCount);
+
+        ~WorkStealingPool();
+
+        void submit(Job job);
+        void wait();
+
+        u32 getWorkerCount() const;
+
+    private:
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        explicit WorkStealingPool(u32 workerCount);
+
+        void run(u32 workerIndex);
+        std::optional<Job> take(u32 workerIndex);
+        void finish();
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::vector<std::thread> m_workers;
+
+        std::mutex m_signalMutex;
+        std::condition_variable m_jobAvailable;
+        std::condition_variable m_jobsDone;
+
+        std::atomic<u64> m_queuedJobs;
+        std::atomic<u64> m_pendingJobs;
+        std::atomic<u32> m_nextQueue;
+        bool m_isStopping;
+    };
+} // namespace processing
+
+#endif // _PROCESSING_INCLUDE_WORK_STEALING_POOL_HPP_